@@ -0,0 +1,61 @@
+#include <new>
+
+/* Defines the needed classes and their headers. */
+#include "Arena.h"
+#include "HugePages.h"
+
+/* Constructor. No block is taken until something is asked for. */
+Arena::Arena():
+    blocks(NULL),
+    used(0),
+    total(0)
+{ }
+
+/* Destructor. */
+Arena::~Arena()
+{
+    release();
+}
+
+/* Each piece goes after the last one, in the newest block. When it doesn't
+ * fit, a new block is taken, larger if the piece needs it.
+ */
+void *Arena::allocate(size_t size, size_t align)
+{
+    size_t start = (used + align - 1) & ~(align - 1);
+
+    if (blocks == NULL || start + size > blocks->size)
+    {
+        size_t header = (sizeof(block) + align - 1) & ~(align - 1);
+        size_t blockSize = header + size > ARENA_BLOCK_SIZE ? header + size : ARENA_BLOCK_SIZE;
+
+        block *b = (block *) HugePages::allocate(blockSize);
+        if (b == NULL)
+            throw std::bad_alloc();
+
+        b->next = blocks;
+        b->size = blockSize;
+        blocks = b;
+        start = header;
+    }
+
+    used = start + size;
+    total += size;
+
+    return (char *) blocks + start;
+}
+
+void Arena::release()
+{
+    while (blocks != NULL)
+    {
+        block *next = blocks->next;
+        HugePages::release(blocks, blocks->size);
+        blocks = next;
+    }
+
+    used = 0;
+    total = 0;
+}
+
+size_t Arena::getTotal() { return total; }
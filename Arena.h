@@ -0,0 +1,58 @@
+#ifndef _H_Arena
+#define _H_Arena
+
+/* Needed libraries. */
+#include <stddef.h>
+
+/* The size of each block the arena takes at once, a huge page. */
+#define ARENA_BLOCK_SIZE (2 << 20)
+
+/* Header for the Arena class. It gives the memory of a scene, each piece
+ * right after the one before, from a few large blocks that are all freed at
+ * once. The objects of a scene thus lie together, in the order they were
+ * made, and a scene is thrown away without freeing each of them. Nothing
+ * made in an arena is ever deleted by itself, so it must own no other
+ * memory when the arena is freed.
+ */
+class Arena
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* The blocks, the last one taken first, each starting with the one
+     * before and its size. Then, how much of the first one is used.
+     */
+    struct block
+    {
+        block *next;
+        size_t size;
+    };
+    block *blocks;
+    size_t used;
+    /* All the memory given, to tell how large the scene is. */
+    size_t total;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. The destructor frees everything. */
+    explicit Arena();
+    ~Arena();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Memory for size bytes, at an address that is a multiple of align, a
+     * power of two.
+     */
+    void *allocate(size_t size, size_t align = 16);
+    /* Frees everything given at once. */
+    void release();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    size_t getTotal();
+};
+
+/* So that "new (arena) Sphere(...)" makes the sphere in the arena. */
+inline void *operator new(size_t size, Arena &arena) { return arena.allocate(size); }
+inline void *operator new[](size_t size, Arena &arena) { return arena.allocate(size); }
+inline void operator delete(void *, Arena &) { }
+inline void operator delete[](void *, Arena &) { }
+
+#endif
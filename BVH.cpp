@@ -0,0 +1,2242 @@
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <float.h>
+#include <algorithm>
+#ifdef __AVX__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "BVH.h"
+#include "HugePages.h"
+#include "PerfCounter.h"
+
+using namespace std;
+
+/* A subtree left to a thread: its objects, how deep it starts, and where
+ * its root goes. Its nodes are made in an arena of its own. In a lazy tree,
+ * it is only built when a ray first reaches it, at root, and state tells if
+ * it is not built yet, being built or built.
+ */
+struct bvhSubtree
+{
+    BVH *bvh;
+    int first, count, depth;
+    bvhBuildNode **slot;
+    Arena *arena;
+    int root;
+    volatile int state;
+};
+
+#define SUBTREE_UNBUILT 0
+#define SUBTREE_BUILDING 1
+#define SUBTREE_BUILT 2
+
+/* The objects of a node shared among the threads: each one finds the box
+ * of its part, and the box of their centres, or puts them into bins along
+ * the axis.
+ */
+struct bvhBinJob
+{
+    BVH *bvh;
+    int first, count;
+    int axis;
+    float low, scale;
+    bvhBox box, centreBox;
+    bvhBox binBoxes[BVH_BINS];
+    int binCounts[BVH_BINS];
+};
+
+/* The Morton codes of a part of the objects, or a part of them to sort, or
+ * two sorted parts to merge.
+ */
+struct bvhSortJob
+{
+    BVH *bvh;
+    unsigned long long *codes, *out;
+    int first, middle, last;
+    bvhBox centreBox;
+};
+
+/* Runs the tasks, each with its own job, on the threads of the pool, and
+ * waits for them. With no pool, they run one after the other.
+ */
+static void runTasks(ThreadPool *pool, taskFunction function, void *jobs, size_t size, int count)
+{
+    char *job = (char *) jobs;
+    int i;
+
+    if (pool == NULL || count == 1)
+    {
+        for (i = 0; i < count; i++)
+            function(job + i * size);
+        return;
+    }
+
+    Future **futures = new Future*[count];
+    for (i = 0; i < count; i++)
+        futures[i] = pool->submit(function, job + i * size);
+
+    for (i = 0; i < count; i++)
+    {
+        futures[i]->wait();
+        delete futures[i];
+    }
+
+    delete [] futures;
+}
+
+static void emptyBox(bvhBox &b)
+{
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        b.lower[k] = FLT_MAX;
+        b.upper[k] = -FLT_MAX;
+    }
+}
+
+static void growBox(bvhBox &b, const bvhBox &other)
+{
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        b.lower[k] = min(b.lower[k], other.lower[k]);
+        b.upper[k] = max(b.upper[k], other.upper[k]);
+    }
+}
+
+static void growBox(bvhBox &b, const float *p)
+{
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        b.lower[k] = min(b.lower[k], p[k]);
+        b.upper[k] = max(b.upper[k], p[k]);
+    }
+}
+
+/* Half the surface of the box, which tells how likely a ray is to cross
+ * it.
+ */
+static double halfArea(const bvhBox &b)
+{
+    if (b.lower[0] > b.upper[0])
+        return 0;
+
+    double dx = b.upper[0] - b.lower[0];
+    double dy = b.upper[1] - b.lower[1];
+    double dz = b.upper[2] - b.lower[2];
+
+    return dx * dy + dy * dz + dz * dx;
+}
+
+static double halfArea(const bvhNode &n)
+{
+    double x = n.upper[0] - n.lower[0];
+    double y = n.upper[1] - n.lower[1];
+    double z = n.upper[2] - n.lower[2];
+
+    return x * y + y * z + z * x;
+}
+
+/* The bin of a centre, along the axis. */
+static inline int binOf(float centre, float low, float scale)
+{
+    int b = (int) ((centre - low) * scale);
+    return b < 0 ? 0 : (b >= BVH_BINS ? BVH_BINS - 1 : b);
+}
+
+/* Tells the objects whose centres are in the bins up to the split. */
+struct bvhLeftOfSplit
+{
+    float (*centres)[3];
+    int axis, split;
+    float low, scale;
+
+    bool operator () (int object) const
+    {
+        return binOf(centres[object][axis], low, scale) <= split;
+    }
+};
+
+/* Orders the objects by their centres, along the axis. */
+struct bvhAlongAxis
+{
+    float (*centres)[3];
+    int axis;
+
+    bool operator () (int a, int b) const
+    {
+        return centres[a][axis] < centres[b][axis];
+    }
+};
+
+static bool largerSubtree(const bvhSubtree &a, const bvhSubtree &b)
+{
+    return a.count > b.count;
+}
+
+/* Spreads the lowest 10 bits of v, so two zeros lie between each of them. */
+static unsigned int spreadBits(unsigned int v)
+{
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/* Constructor. */
+BVH::BVH(int method, int width, bool compressed, bool dynamic):
+    method(method),
+    width(width == 2 && !compressed ? 2 : BVH_WIDTH),
+    compressed(compressed && !dynamic),
+    dynamic(dynamic),
+    lazy(false),
+    noNodes(0),
+    nodesSize(0),
+    nodes(NULL),
+    noWideNodes(0),
+    wideNodesSize(0),
+    wideNodes(NULL),
+    compressedNodes(NULL),
+    noItems(0),
+    items(NULL),
+    noUnbounded(0),
+    unbounded(NULL),
+    noObjects(0),
+    boxes(NULL),
+    centres(NULL),
+    pool(NULL),
+    noSubtrees(0),
+    subtreesSize(0),
+    subtreeLimit(0),
+    subtrees(NULL),
+    codes(NULL),
+    buildTime(0),
+    parents(NULL),
+    costs(NULL),
+    builtCosts(NULL),
+    leaves(NULL),
+    wideSources(NULL),
+    wideParents(NULL),
+    wideFirsts(NULL),
+    wideEnds(NULL),
+    laneOf(NULL),
+    openedBy(NULL),
+    noRefitted(0),
+    noRebuilt(0),
+    updateTime(0),
+    noExpanded(0),
+    memberObjects(NULL)
+{ }
+
+/* Destructor. */
+BVH::~BVH()
+{
+    release();
+}
+
+/* Frees the tree and all that was kept with it. */
+void BVH::release()
+{
+    HugePages::release(nodes, nodesSize * sizeof(bvhNode));
+    HugePages::release(wideNodes, wideNodesSize * sizeof(bvhWideNode));
+    HugePages::release(compressedNodes, noWideNodes * sizeof(bvhCompressedNode));
+    delete [] items;
+    delete [] unbounded;
+    delete [] boxes;
+    delete [] centres;
+    delete [] parents;
+    delete [] costs;
+    delete [] builtCosts;
+    delete [] leaves;
+    delete [] wideSources;
+    delete [] wideParents;
+    delete [] wideFirsts;
+    delete [] wideEnds;
+    delete [] laneOf;
+    delete [] openedBy;
+    delete [] memberObjects;
+
+    nodes = NULL;
+    wideNodes = NULL;
+    compressedNodes = NULL;
+    items = NULL;
+    unbounded = NULL;
+    boxes = NULL;
+    centres = NULL;
+    parents = NULL;
+    costs = NULL;
+    builtCosts = NULL;
+    leaves = NULL;
+    wideSources = NULL;
+    wideParents = NULL;
+    wideFirsts = NULL;
+    wideEnds = NULL;
+    laneOf = NULL;
+    openedBy = NULL;
+    memberObjects = NULL;
+    freeSubtrees();
+    noNodes = 0;
+    nodesSize = 0;
+    noExpanded = 0;
+    noWideNodes = 0;
+    wideNodesSize = 0;
+    noItems = 0;
+    noUnbounded = 0;
+}
+
+/* The objects are put into bins by their centres, along the axis. */
+void BVH::binObjects(int first, int count, int axis, float low, float scale,
+                     bvhBox &box, bvhBox &centreBox, bvhBox *binBoxes, int *binCounts)
+{
+    int i, b;
+
+    emptyBox(box);
+    emptyBox(centreBox);
+    for (b = 0; b < BVH_BINS; b++)
+    {
+        emptyBox(binBoxes[b]);
+        binCounts[b] = 0;
+    }
+
+    for (i = first; i < first + count; i++)
+    {
+        int object = items[i];
+        growBox(box, boxes[object]);
+        growBox(centreBox, centres[object]);
+
+        if (axis >= 0)
+        {
+            b = binOf(centres[object][axis], low, scale);
+            growBox(binBoxes[b], boxes[object]);
+            binCounts[b]++;
+        }
+    }
+}
+
+void *BVH::binTask(void *task)
+{
+    bvhBinJob *j = (bvhBinJob *) task;
+
+    j->bvh->binObjects(j->first, j->count, j->axis, j->low, j->scale,
+                       j->box, j->centreBox, j->binBoxes, j->binCounts);
+    return NULL;
+}
+
+/* A node whose objects are built by a thread later, while at the top. */
+bool BVH::leaveSubtree(int first, int count, int depth, bvhBuildNode **slot)
+{
+    if (count > subtreeLimit)
+        return false;
+
+    if (noSubtrees == subtreesSize)
+    {
+        subtreesSize = subtreesSize > 0 ? 2 * subtreesSize : 64;
+        bvhSubtree *bigger = new bvhSubtree[subtreesSize];
+        if (noSubtrees > 0)
+            memcpy(bigger, subtrees, noSubtrees * sizeof(bvhSubtree));
+        delete [] subtrees;
+        subtrees = bigger;
+    }
+
+    bvhSubtree &s = subtrees[noSubtrees++];
+    s.bvh = this;
+    s.first = first;
+    s.count = count;
+    s.depth = depth;
+    s.slot = slot;
+    s.arena = NULL;
+    s.root = -1;
+    s.state = SUBTREE_UNBUILT;
+
+    return true;
+}
+
+bvhBuildNode *BVH::makeNode(int first, int count, Arena &arena)
+{
+    bvhBuildNode *node = new (arena) bvhBuildNode;
+
+    node->children[0] = NULL;
+    node->children[1] = NULL;
+    node->first = first;
+    node->count = count;
+
+    return node;
+}
+
+/* The objects are split where the surface area heuristic says a ray costs
+ * least: each side costs as many objects as it has, times the chance of a
+ * ray crossing its box. A few objects stay in a leaf if that is cheaper.
+ */
+void BVH::buildSAH(int first, int count, int depth, bvhBuildNode **slot, Arena &arena, bool top)
+{
+    bvhBox box, centreBox, binBoxes[BVH_BINS];
+    int binCounts[BVH_BINS];
+    int i, b, k;
+
+    if (top && leaveSubtree(first, count, depth, slot))
+        return;
+
+    /* First, the box of the centres, to place the bins. At the top, the
+     * objects are shared among the threads.
+     */
+    bool shared = top && pool != NULL && count >= BVH_PARALLEL_BINNING;
+    int noJobs = shared ? pool->getNoThreads() : 1;
+    bvhBinJob *jobs = shared ? new bvhBinJob[noJobs] : NULL;
+
+    if (shared)
+    {
+        for (i = 0; i < noJobs; i++)
+        {
+            jobs[i].bvh = this;
+            jobs[i].first = first + (long long) count * i / noJobs;
+            jobs[i].count = first + (long long) count * (i + 1) / noJobs - jobs[i].first;
+            jobs[i].axis = -1;
+        }
+        runTasks(pool, binTask, jobs, sizeof(bvhBinJob), noJobs);
+
+        emptyBox(box);
+        emptyBox(centreBox);
+        for (i = 0; i < noJobs; i++)
+        {
+            growBox(box, jobs[i].box);
+            growBox(centreBox, jobs[i].centreBox);
+        }
+    }
+    else
+        binObjects(first, count, -1, 0, 0, box, centreBox, binBoxes, binCounts);
+
+    if (count <= 1)
+    {
+        delete [] jobs;
+        *slot = makeNode(first, count, arena);
+        return;
+    }
+
+    /* The bins go along the longest axis of the centres. */
+    int axis = 0;
+    for (k = 1; k < 3; k++)
+        if (centreBox.upper[k] - centreBox.lower[k] > centreBox.upper[axis] - centreBox.lower[axis])
+            axis = k;
+
+    float extent = centreBox.upper[axis] - centreBox.lower[axis];
+    int split = -1;
+    double bestCost = DBL_MAX;
+
+    if (extent > 0 && depth < BVH_MAX_DEPTH)
+    {
+        float low = centreBox.lower[axis];
+        float scale = BVH_BINS / extent;
+
+        if (shared)
+        {
+            for (i = 0; i < noJobs; i++)
+            {
+                jobs[i].axis = axis;
+                jobs[i].low = low;
+                jobs[i].scale = scale;
+            }
+            runTasks(pool, binTask, jobs, sizeof(bvhBinJob), noJobs);
+
+            for (b = 0; b < BVH_BINS; b++)
+            {
+                emptyBox(binBoxes[b]);
+                binCounts[b] = 0;
+                for (i = 0; i < noJobs; i++)
+                {
+                    growBox(binBoxes[b], jobs[i].binBoxes[b]);
+                    binCounts[b] += jobs[i].binCounts[b];
+                }
+            }
+        }
+        else
+            binObjects(first, count, axis, low, scale, box, centreBox, binBoxes, binCounts);
+
+        /* The cost of each split, from both sides. */
+        double rightCost[BVH_BINS];
+        bvhBox side;
+        int n = 0;
+
+        emptyBox(side);
+        for (b = BVH_BINS - 1; b > 0; b--)
+        {
+            growBox(side, binBoxes[b]);
+            n += binCounts[b];
+            rightCost[b] = halfArea(side) * n;
+        }
+
+        emptyBox(side);
+        n = 0;
+        for (b = 0; b < BVH_BINS - 1; b++)
+        {
+            growBox(side, binBoxes[b]);
+            n += binCounts[b];
+            double cost = halfArea(side) * n + rightCost[b + 1];
+
+            if (n > 0 && n < count && cost < bestCost)
+            {
+                bestCost = cost;
+                split = b;
+            }
+        }
+
+        /* A leaf costs every object, for every ray crossing the node; a
+         * split also costs the test of the two boxes.
+         */
+        if (count <= BVH_LEAF_SIZE && count * halfArea(box) <= halfArea(box) + bestCost)
+            split = -1;
+        else if (split >= 0)
+        {
+            bvhLeftOfSplit left = {centres, axis, split, low, scale};
+            split = partition(&items[first], &items[first + count], left) - &items[first];
+        }
+    }
+
+    delete [] jobs;
+
+    if (split < 0 && count <= BVH_LEAF_SIZE)
+    {
+        *slot = makeNode(first, count, arena);
+        return;
+    }
+
+    /* With no good split, the objects are cut in halves. */
+    if (split <= 0 || split >= count)
+    {
+        bvhAlongAxis along = {centres, axis};
+        split = count / 2;
+        nth_element(&items[first], &items[first + split], &items[first + count], along);
+    }
+
+    bvhBuildNode *node = makeNode(first, 0, arena);
+    *slot = node;
+    buildSAH(first, split, depth + 1, &node->children[0], arena, top);
+    buildSAH(first + split, count - split, depth + 1, &node->children[1], arena, top);
+}
+
+/* The objects are sorted by their Morton codes, which follow a curve that
+ * keeps close points close in the list. Then, each node is split where the
+ * highest bit that differs among its codes changes.
+ */
+void BVH::buildLBVH(int first, int count, int depth, bvhBuildNode **slot, Arena &arena, bool top)
+{
+    if (top && leaveSubtree(first, count, depth, slot))
+        return;
+
+    if (count <= BVH_LEAF_SIZE)
+    {
+        *slot = makeNode(first, count, arena);
+        return;
+    }
+
+    unsigned int firstCode = codes[first] >> 32;
+    unsigned int lastCode = codes[first + count - 1] >> 32;
+    int split = count / 2;
+
+    if (firstCode != lastCode && depth < BVH_MAX_DEPTH)
+    {
+        int bit = 31;
+        while (!(((firstCode ^ lastCode) >> bit) & 1))
+            bit--;
+
+        /* The first object with the bit set. */
+        int low = first, high = first + count - 1;
+        while (low < high)
+        {
+            int middle = (low + high) / 2;
+            if (((unsigned int) (codes[middle] >> 32) >> bit) & 1)
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        split = low - first;
+    }
+
+    bvhBuildNode *node = makeNode(first, 0, arena);
+    *slot = node;
+    buildLBVH(first, split, depth + 1, &node->children[0], arena, top);
+    buildLBVH(first + split, count - split, depth + 1, &node->children[1], arena, top);
+}
+
+void *BVH::subtreeTask(void *task)
+{
+    bvhSubtree *s = (bvhSubtree *) task;
+
+    /* The codes are only there while the whole tree is built. */
+    s->arena = new Arena();
+    if (s->bvh->codes != NULL)
+        s->bvh->buildLBVH(s->first, s->count, s->depth, s->slot, *s->arena, false);
+    else
+        s->bvh->buildSAH(s->first, s->count, s->depth, s->slot, *s->arena, false);
+
+    return NULL;
+}
+
+/* The subtrees left at the top, the largest first, so no thread is left
+ * with a large one at the end.
+ */
+void BVH::runSubtrees()
+{
+    sort(subtrees, subtrees + noSubtrees, largerSubtree);
+
+    runTasks(pool, subtreeTask, subtrees, sizeof(bvhSubtree), noSubtrees);
+}
+
+/* Each code has the Morton code of the centre of the object in the high
+ * half, and the object in the low one.
+ */
+void *BVH::codeTask(void *task)
+{
+    bvhSortJob *j = (bvhSortJob *) task;
+    BVH *b = j->bvh;
+    int i, k;
+    unsigned int cell[3];
+
+    for (i = j->first; i < j->last; i++)
+    {
+        int object = b->items[i];
+        for (k = 0; k < 3; k++)
+        {
+            float extent = j->centreBox.upper[k] - j->centreBox.lower[k];
+            float f = extent > 0 ? (b->centres[object][k] - j->centreBox.lower[k]) / extent : 0;
+            cell[k] = (unsigned int) (f * 1023.0f);
+        }
+
+        unsigned long long code = spreadBits(cell[0]) << 2 | spreadBits(cell[1]) << 1 | spreadBits(cell[2]);
+        b->codes[i] = code << 32 | (unsigned int) object;
+    }
+
+    return NULL;
+}
+
+/* Sorts a part of the codes, or merges two sorted parts into out. */
+void *BVH::sortTask(void *task)
+{
+    bvhSortJob *j = (bvhSortJob *) task;
+
+    if (j->out == NULL)
+        sort(j->codes + j->first, j->codes + j->last);
+    else
+        merge(j->codes + j->first, j->codes + j->middle, j->codes + j->middle, j->codes + j->last,
+              j->out + j->first);
+
+    return NULL;
+}
+
+/* Each thread sorts a part of the codes. Then, the sorted parts are merged
+ * two by two, by many threads at once, until a single one is left.
+ */
+void BVH::sortCodes()
+{
+    int i, noParts = pool != NULL ? 4 * pool->getNoThreads() : 1;
+    bvhSortJob *jobs = new bvhSortJob[noParts];
+    unsigned long long *other = new unsigned long long[noItems];
+    int *bounds = new int[noParts + 1];
+
+    for (i = 0; i <= noParts; i++)
+        bounds[i] = (long long) noItems * i / noParts;
+
+    for (i = 0; i < noParts; i++)
+    {
+        jobs[i].codes = codes;
+        jobs[i].out = NULL;
+        jobs[i].first = bounds[i];
+        jobs[i].last = bounds[i + 1];
+    }
+    runTasks(pool, sortTask, jobs, sizeof(bvhSortJob), noParts);
+
+    int step;
+    for (step = 1; step < noParts; step *= 2)
+    {
+        int noMerges = 0;
+        for (i = 0; i < noParts; i += 2 * step)
+        {
+            bvhSortJob &j = jobs[noMerges++];
+            j.codes = codes;
+            j.out = other;
+            j.first = bounds[i];
+            j.middle = bounds[min(i + step, noParts)];
+            j.last = bounds[min(i + 2 * step, noParts)];
+        }
+        runTasks(pool, sortTask, jobs, sizeof(bvhSortJob), noMerges);
+
+        swap(codes, other);
+    }
+
+    delete [] other;
+    delete [] jobs;
+    delete [] bounds;
+}
+
+/* The tree is laid out depth first, so the first child of each node comes
+ * right after it. The box of each node is the one around its children.
+ */
+void BVH::flatten(bvhBuildNode *node, int &next)
+{
+    int i, index = next++;
+    bvhNode &n = nodes[index];
+
+    /* A subtree of a lazy tree, not built yet, is a leaf of all its
+     * objects for now, and only keeps which subtree it is.
+     */
+    if (node->count < 0)
+    {
+        const bvhSubtree &s = subtrees[-1 - node->count];
+        bvhBox box;
+        emptyBox(box);
+        for (i = s.first; i < s.first + s.count; i++)
+            growBox(box, boxes[items[i]]);
+
+        memcpy(n.lower, box.lower, sizeof(n.lower));
+        memcpy(n.upper, box.upper, sizeof(n.upper));
+        n.count = node->count;
+        n.offset = -1 - node->count;
+        return;
+    }
+
+    if (node->count > 0 || node->children[0] == NULL)
+    {
+        bvhBox box;
+        emptyBox(box);
+        for (i = node->first; i < node->first + node->count; i++)
+            growBox(box, boxes[items[i]]);
+
+        memcpy(n.lower, box.lower, sizeof(n.lower));
+        memcpy(n.upper, box.upper, sizeof(n.upper));
+        n.count = node->count;
+        n.offset = node->first;
+        return;
+    }
+
+    flatten(node->children[0], next);
+    int second = next;
+    flatten(node->children[1], next);
+
+    bvhNode &a = nodes[index + 1];
+    bvhNode &b = nodes[second];
+    for (i = 0; i < 3; i++)
+    {
+        n.lower[i] = min(a.lower[i], b.lower[i]);
+        n.upper[i] = max(a.upper[i], b.upper[i]);
+    }
+    n.count = 0;
+    n.offset = second;
+}
+
+/* The wide node takes the place of the binary one and of the levels just
+ * below it: of its children, the one with the largest box is replaced by
+ * its own two, while there is room for them. The binary nodes opened are
+ * kept as the wide node's own, if it is given.
+ */
+int BVH::openLanes(int node, int index, int *lanes)
+{
+    int i, noLanes = 1;
+
+    lanes[0] = node;
+    while (noLanes < BVH_WIDTH)
+    {
+        int largest = -1;
+        double largestArea = -1;
+
+        for (i = 0; i < noLanes; i++)
+            if (nodes[lanes[i]].count == 0 && halfArea(nodes[lanes[i]]) > largestArea)
+            {
+                largest = i;
+                largestArea = halfArea(nodes[lanes[i]]);
+            }
+
+        if (largest == -1)
+            break;
+
+        int opened = lanes[largest];
+        lanes[largest] = opened + 1;
+        lanes[noLanes++] = nodes[opened].offset;
+
+        if (index >= 0 && openedBy != NULL)
+            openedBy[opened] = index;
+    }
+
+    return noLanes;
+}
+
+/* The wide nodes the binary node becomes, with the ones below it. */
+int BVH::countWide(int node)
+{
+    int lanes[BVH_WIDTH];
+    int i, count = 1;
+    int noLanes = openLanes(node, -1, lanes);
+
+    for (i = 0; i < noLanes; i++)
+        if (nodes[lanes[i]].count == 0)
+            count += countWide(lanes[i]);
+
+    return count;
+}
+
+/* The children that are not leaves become wide nodes too, one after the
+ * other from next, and then the ones below them.
+ */
+void BVH::collapse(int node, int index, int &next)
+{
+    int lanes[BVH_WIDTH];
+    int i, k;
+    int noLanes = openLanes(node, index, lanes);
+
+    if (wideSources != NULL)
+    {
+        wideSources[index] = node;
+        wideFirsts[index] = next;
+    }
+
+    bvhWideNode &w = wideNodes[index];
+    for (i = 0; i < BVH_WIDTH; i++)
+    {
+        if (i >= noLanes)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                w.lower[k][i] = FLT_MAX;
+                w.upper[k][i] = -FLT_MAX;
+            }
+            w.child[i] = 0;
+            w.count[i] = -1;
+            continue;
+        }
+
+        const bvhNode &n = nodes[lanes[i]];
+        for (k = 0; k < 3; k++)
+        {
+            w.lower[k][i] = n.lower[k];
+            w.upper[k][i] = n.upper[k];
+        }
+        w.count[i] = n.count;
+        w.child[i] = n.count > 0 ? n.offset : next++;
+
+        if (laneOf != NULL)
+            laneOf[lanes[i]] = index * BVH_WIDTH + i;
+        if (wideParents != NULL && n.count == 0)
+            wideParents[w.child[i]] = index;
+    }
+
+    for (i = 0; i < noLanes; i++)
+        if (w.count[i] == 0)
+            collapse(lanes[i], w.child[i], next);
+
+    if (wideEnds != NULL)
+        wideEnds[index] = next;
+}
+
+/* Each wide node is compressed in its place. The objects of its leaves are
+ * copied one after the other, so their places fit in the slots.
+ */
+void BVH::compress()
+{
+    int i, k, lane;
+    int *packed = new int[noItems];
+    int noPacked = 0;
+
+    compressedNodes = (bvhCompressedNode *) HugePages::allocate(noWideNodes * sizeof(bvhCompressedNode));
+
+    for (i = 0; i < noWideNodes; i++)
+    {
+        const bvhWideNode &w = wideNodes[i];
+        bvhCompressedNode &c = compressedNodes[i];
+        memset(&c, 0, sizeof(c));
+
+        /* The box of the node, and the steps a little larger than needed,
+         * so the last one is past its upper side.
+         */
+        for (k = 0; k < 3; k++)
+        {
+            float lower = FLT_MAX, upper = -FLT_MAX;
+            for (lane = 0; lane < BVH_WIDTH; lane++)
+                if (w.count[lane] >= 0)
+                {
+                    lower = min(lower, w.lower[k][lane]);
+                    upper = max(upper, w.upper[k][lane]);
+                }
+
+            c.origin[k] = lower;
+            c.scale[k] = max((upper - lower) / BVH_QUANTA * 1.0001f, FLT_MIN);
+        }
+
+        /* The sides of each box are rounded out to the steps. The unused
+         * children have their sides swapped, so no ray enters them.
+         */
+        c.firstChild = 0;
+        c.firstItem = noPacked;
+        bool firstChild = true;
+        for (lane = 0; lane < BVH_WIDTH; lane++)
+        {
+            if (w.count[lane] < 0)
+            {
+                for (k = 0; k < 3; k++)
+                {
+                    c.lower[k][lane] = BVH_QUANTA;
+                    c.upper[k][lane] = 0;
+                }
+                continue;
+            }
+
+            for (k = 0; k < 3; k++)
+            {
+                float step = c.scale[k];
+                int lower = (int) floor((w.lower[k][lane] - c.origin[k]) / step);
+                int upper = (int) ceil((w.upper[k][lane] - c.origin[k]) / step);
+
+                lower = max(0, min(lower, BVH_QUANTA));
+                upper = max(0, min(upper, BVH_QUANTA));
+                while (lower > 0 && c.origin[k] + lower * step > w.lower[k][lane])
+                    lower--;
+                while (upper < BVH_QUANTA && c.origin[k] + upper * step < w.upper[k][lane])
+                    upper++;
+
+                c.lower[k][lane] = (unsigned char) lower;
+                c.upper[k][lane] = (unsigned char) upper;
+            }
+
+            /* The children that are nodes were placed one after the other. */
+            if (w.count[lane] == 0)
+            {
+                if (firstChild)
+                {
+                    c.firstChild = w.child[lane];
+                    firstChild = false;
+                }
+                c.slot[lane] = (unsigned char) (w.child[lane] - c.firstChild);
+            }
+            else
+            {
+                c.slot[lane] = (unsigned char) (w.count[lane] << BVH_SLOT_BITS | (noPacked - c.firstItem));
+                memcpy(&packed[noPacked], &items[w.child[lane]], w.count[lane] * sizeof(int));
+                noPacked += w.count[lane];
+            }
+        }
+    }
+
+    delete [] items;
+    items = packed;
+
+    HugePages::release(wideNodes, wideNodesSize * sizeof(bvhWideNode));
+    wideNodes = NULL;
+    wideNodesSize = 0;
+}
+
+/* The box of the object is made a little larger, so the rays that touch
+ * it on its edges are never lost to rounding. Its centre is given too, if
+ * asked for. Returns false if it has no box.
+ */
+bool BVH::boxOf(Object *object, bvhBox &box, float *centre)
+{
+    point lower, upper;
+    int k;
+
+    if (!object->getBounds(lower, upper))
+        return false;
+
+    double l[3] = {lower.x, lower.y, lower.z};
+    double u[3] = {upper.x, upper.y, upper.z};
+    for (k = 0; k < 3; k++)
+    {
+        double pad = 1e-4 * (fabs(l[k]) > fabs(u[k]) ? fabs(l[k]) : fabs(u[k])) + 1e-4;
+        box.lower[k] = l[k] - pad;
+        box.upper[k] = u[k] + pad;
+        if (centre != NULL)
+            centre[k] = (l[k] + u[k]) / 2;
+    }
+
+    return true;
+}
+
+/* The box of the object i of the tree, and its centre. */
+bool BVH::boundObject(Object *object, int i)
+{
+    return boxOf(object, boxes[i], centres[i]);
+}
+
+/* The arenas of the subtrees left to the threads. */
+void BVH::freeSubtrees()
+{
+    int i;
+
+    for (i = 0; i < noSubtrees; i++)
+        delete subtrees[i].arena;
+    delete [] subtrees;
+    subtrees = NULL;
+    noSubtrees = 0;
+    subtreesSize = 0;
+}
+
+void BVH::build(Object **objects, int noObjects, ThreadPool *pool)
+{
+    build(objects, NULL, noObjects, pool);
+}
+
+/* While it is built, the tree knows its objects by their place among the
+ * members, and only then by their own.
+ */
+void BVH::build(Object **objects, const int *members, int noMembers, ThreadPool *pool)
+{
+    double start = PerfCounter::now();
+    int i, j;
+
+    release();
+
+    this->pool = pool != NULL && pool->getNoThreads() > 1 ? pool : NULL;
+    this->noObjects = noMembers;
+    items = new int[noMembers];
+    unbounded = new int[noMembers];
+    boxes = new bvhBox[noMembers];
+    centres = new float[noMembers][3];
+    emptyBox(bounds);
+
+    for (i = 0; i < noMembers; i++)
+    {
+        int object = members != NULL ? members[i] : i;
+        if (boundObject(objects[object], i))
+        {
+            items[noItems++] = i;
+            growBox(bounds, boxes[i]);
+        }
+        else
+            unbounded[noUnbounded++] = object;
+    }
+
+    if (noItems > 0)
+    {
+        Arena arena;
+        bvhBuildNode *root = NULL;
+
+        /* Enough subtrees for the threads to share them well. */
+        subtreeLimit = this->pool != NULL ? max(noItems / (8 * this->pool->getNoThreads()), 256) : noItems;
+        if (lazy)
+            subtreeLimit = BVH_LAZY_SUBTREE;
+        noSubtrees = 0;
+
+        if (method == BVH_LBVH)
+        {
+            bvhSortJob job;
+            job.bvh = this;
+            emptyBox(job.centreBox);
+            for (i = 0; i < noItems; i++)
+                growBox(job.centreBox, centres[items[i]]);
+
+            codes = new unsigned long long[noItems];
+            int noParts = this->pool != NULL ? this->pool->getNoThreads() : 1;
+            bvhSortJob *jobs = new bvhSortJob[noParts];
+            for (i = 0; i < noParts; i++)
+            {
+                jobs[i] = job;
+                jobs[i].first = (long long) noItems * i / noParts;
+                jobs[i].last = (long long) noItems * (i + 1) / noParts;
+            }
+            runTasks(this->pool, codeTask, jobs, sizeof(bvhSortJob), noParts);
+            delete [] jobs;
+
+            sortCodes();
+            for (i = 0; i < noItems; i++)
+                items[i] = (int) (codes[i] & 0xFFFFFFFF);
+
+            buildLBVH(0, noItems, 0, &root, arena, true);
+        }
+        else
+            buildSAH(0, noItems, 0, &root, arena, true);
+
+        /* A lazy tree only builds its top now, and leaves room after it for
+         * each subtree, as many nodes as it may need.
+         */
+        nodesSize = 2 * noItems + (lazy ? noSubtrees : 0);
+        nodes = (bvhNode *) HugePages::allocate(nodesSize * sizeof(bvhNode));
+        if (lazy)
+        {
+            for (i = 0; i < noSubtrees; i++)
+                *subtrees[i].slot = makeNode(subtrees[i].first, -1 - i, arena);
+            flatten(root, noNodes);
+
+            int next = noNodes;
+            for (i = 0; i < noSubtrees; i++)
+            {
+                subtrees[i].root = next;
+                next += 2 * subtrees[i].count - 1;
+            }
+        }
+        else
+        {
+            runSubtrees();
+            flatten(root, noNodes);
+            freeSubtrees();
+        }
+
+        delete [] codes;
+        codes = NULL;
+
+        /* A tree to be updated knows the node above each one, and what
+         * each costs.
+         */
+        if (dynamic)
+        {
+            parents = new int[2 * noItems];
+            costs = new float[2 * noItems];
+            builtCosts = new float[2 * noItems];
+            leaves = new int[noObjects];
+            for (i = 0; i < noObjects; i++)
+                leaves[i] = -1;
+
+            parents[0] = -1;
+            link(0, noNodes);
+        }
+
+        if (members != NULL && lazy)
+        {
+            /* Only the objects in no subtree are known by their own now. */
+            memberObjects = new int[noMembers];
+            memcpy(memberObjects, members, noMembers * sizeof(int));
+
+            bool *waiting = new bool[noItems];
+            for (i = 0; i < noItems; i++)
+                waiting[i] = false;
+            for (j = 0; j < noSubtrees; j++)
+                for (i = subtrees[j].first; i < subtrees[j].first + subtrees[j].count; i++)
+                    waiting[i] = true;
+            for (i = 0; i < noItems; i++)
+                if (!waiting[i])
+                    items[i] = members[items[i]];
+            delete [] waiting;
+        }
+        else if (members != NULL)
+            for (i = 0; i < noItems; i++)
+                items[i] = members[items[i]];
+
+        /* Each wide node stands for one binary node at least, which is not
+         * a leaf, unless the root is one. One that is updated may need as
+         * many as there are objects.
+         */
+        if (width > 2)
+        {
+            wideNodesSize = dynamic ? noItems + 1 : countWide(0);
+            wideNodes = (bvhWideNode *) HugePages::allocate(wideNodesSize * sizeof(bvhWideNode));
+
+            if (dynamic)
+            {
+                wideSources = new int[wideNodesSize];
+                wideParents = new int[wideNodesSize];
+                wideFirsts = new int[wideNodesSize];
+                wideEnds = new int[wideNodesSize];
+                laneOf = new int[2 * noItems];
+                openedBy = new int[2 * noItems];
+                for (i = 0; i < 2 * noItems; i++)
+                {
+                    laneOf[i] = -1;
+                    openedBy[i] = -1;
+                }
+                wideParents[0] = -1;
+            }
+
+            noWideNodes = 1;
+            collapse(0, 0, noWideNodes);
+
+            if (!dynamic)
+            {
+                HugePages::release(nodes, 2 * (size_t) noItems * sizeof(bvhNode));
+                nodes = NULL;
+            }
+
+            if (compressed)
+                compress();
+        }
+    }
+
+    /* Only a tree that is updated, or lazy, needs the boxes again. */
+    if (!dynamic && !lazy)
+    {
+        delete [] boxes;
+        delete [] centres;
+        boxes = NULL;
+        centres = NULL;
+    }
+
+    buildTime = PerfCounter::now() - start;
+}
+
+/* The node after the last one below the node, which is its last leaf. */
+int BVH::subtreeEnd(int node)
+{
+    while (nodes[node].count == 0)
+        node = nodes[node].offset;
+
+    return node + 1;
+}
+
+/* The nodes in use from the node down. */
+int BVH::countNodes(int node)
+{
+    if (nodes[node].count > 0)
+        return 1;
+
+    return 1 + countNodes(node + 1) + countNodes(nodes[node].offset);
+}
+
+/* The wide nodes in use from the wide node down. */
+int BVH::liveWide(int index)
+{
+    int i, count = 1;
+
+    for (i = 0; i < BVH_WIDTH; i++)
+        if (wideNodes[index].count[i] == 0)
+            count += liveWide(wideNodes[index].child[i]);
+
+    return count;
+}
+
+/* Makes the box of the node fit its objects or its children again, and
+ * finds its cost: each object of a leaf, and the test of the boxes of the
+ * children, times the chance of a ray crossing it. The child of a wide node
+ * that the node is gets the same box. Returns false if nothing changed.
+ */
+bool BVH::refit(int node)
+{
+    bvhNode &n = nodes[node];
+    bvhBox box;
+    float cost;
+    int i, k;
+
+    emptyBox(box);
+    if (n.count > 0)
+    {
+        for (i = n.offset; i < n.offset + n.count; i++)
+            growBox(box, boxes[items[i]]);
+        cost = (float) (n.count * halfArea(box));
+    }
+    else
+    {
+        const bvhNode &a = nodes[node + 1];
+        const bvhNode &b = nodes[n.offset];
+        for (k = 0; k < 3; k++)
+        {
+            box.lower[k] = min(a.lower[k], b.lower[k]);
+            box.upper[k] = max(a.upper[k], b.upper[k]);
+        }
+        cost = (float) halfArea(box) + costs[node + 1] + costs[n.offset];
+    }
+
+    noRefitted++;
+    bool moved = memcmp(n.lower, box.lower, sizeof(n.lower)) != 0 ||
+                 memcmp(n.upper, box.upper, sizeof(n.upper)) != 0;
+    if (!moved && cost == costs[node])
+        return false;
+
+    memcpy(n.lower, box.lower, sizeof(n.lower));
+    memcpy(n.upper, box.upper, sizeof(n.upper));
+    costs[node] = cost;
+
+    if (moved && laneOf != NULL && laneOf[node] >= 0)
+    {
+        bvhWideNode &w = wideNodes[laneOf[node] / BVH_WIDTH];
+        int lane = laneOf[node] % BVH_WIDTH;
+        for (k = 0; k < 3; k++)
+        {
+            w.lower[k][lane] = n.lower[k];
+            w.upper[k][lane] = n.upper[k];
+        }
+    }
+
+    return true;
+}
+
+/* The nodes from first to last were just laid out: each one learns the one
+ * above it, and its cost, which is also its cost as built.
+ */
+void BVH::link(int first, int last)
+{
+    int i, k;
+
+    for (i = first; i < last; i++)
+    {
+        const bvhNode &n = nodes[i];
+        if (n.count > 0)
+        {
+            for (k = n.offset; k < n.offset + n.count; k++)
+                leaves[items[k]] = i;
+        }
+        else
+        {
+            parents[i + 1] = i;
+            parents[n.offset] = i;
+        }
+    }
+
+    /* The children come after their node, so they are done first. */
+    for (i = last - 1; i >= first; i--)
+    {
+        const bvhNode &n = nodes[i];
+        bvhBox box;
+        memcpy(box.lower, n.lower, sizeof(box.lower));
+        memcpy(box.upper, n.upper, sizeof(box.upper));
+
+        if (n.count > 0)
+            costs[i] = (float) (n.count * halfArea(box));
+        else
+            costs[i] = (float) halfArea(box) + costs[i + 1] + costs[n.offset];
+        builtCosts[i] = costs[i];
+    }
+}
+
+/* The subtree is built again in its place, over the same objects, with the
+ * surface area heuristic. If it needs more nodes than it had room for, the
+ * node above it is built again instead. Returns the node built again, and
+ * the end of the room it had.
+ */
+int BVH::rebuild(int node, int &end)
+{
+    int i;
+
+    for (;;)
+    {
+        int leftmost = node, depth = 0;
+        while (nodes[leftmost].count == 0)
+            leftmost++;
+        for (i = node; i != 0; i = parents[i])
+            depth++;
+
+        int rightmost = subtreeEnd(node) - 1;
+        int first = nodes[leftmost].offset;
+        int last = nodes[rightmost].offset + nodes[rightmost].count;
+        end = node == 0 ? 2 * noItems : rightmost + 1;
+
+        Arena arena;
+        bvhBuildNode *root = NULL;
+        subtreeLimit = pool != NULL ? max((last - first) / (8 * pool->getNoThreads()), 256) : last - first;
+        noSubtrees = 0;
+        buildSAH(first, last - first, depth, &root, arena, true);
+        runSubtrees();
+
+        /* The nodes of the new subtree, counted as they are laid out. */
+        int size = 0, stackSize = 0;
+        bvhBuildNode *stack[BVH_STACK_SIZE];
+        stack[stackSize++] = root;
+        while (stackSize > 0)
+        {
+            bvhBuildNode *b = stack[--stackSize];
+            size++;
+            if (b->count == 0 && b->children[0] != NULL)
+            {
+                stack[stackSize++] = b->children[0];
+                stack[stackSize++] = b->children[1];
+            }
+        }
+
+        if (size <= end - node)
+        {
+            int next = node;
+            noNodes += size - countNodes(node);
+            flatten(root, next);
+            freeSubtrees();
+            link(node, next);
+            noRebuilt++;
+            return node;
+        }
+
+        freeSubtrees();
+        node = parents[node];
+    }
+}
+
+/* The wide node is made again, with the ones below it, from the binary
+ * nodes it stands for, in the room its nodes had. If they don't fit, the
+ * wide node above it is made again instead.
+ */
+void BVH::recollapse(int index)
+{
+    int i;
+
+    while (index != 0 && countWide(wideSources[index]) - 1 > wideEnds[index] - wideFirsts[index])
+        index = wideParents[index];
+
+    /* The binary nodes below the one it stands for may now be elsewhere. */
+    int source = wideSources[index];
+    int end = index == 0 ? 2 * noItems : subtreeEnd(source);
+    for (i = source; i < end; i++)
+    {
+        if (i > source)
+            laneOf[i] = -1;
+        openedBy[i] = -1;
+    }
+
+    int first = index == 0 ? 1 : wideFirsts[index];
+    int last = index == 0 ? wideNodesSize : wideEnds[index];
+    int next = first;
+    noWideNodes -= liveWide(index);
+    collapse(source, index, next);
+    noWideNodes += 1 + next - first;
+
+    /* The room stays the same, even if less of it is used. */
+    wideFirsts[index] = first;
+    wideEnds[index] = last;
+}
+
+/* First, the boxes of the objects moved and of their leaves are made to fit
+ * again, then those of the nodes above them, up to the first one that does
+ * not change. Then, above each leaf, the highest node whose cost grew too
+ * much is built again, with the wide nodes that stand for it.
+ */
+void BVH::update(Object **objects, const int *moved, int noMoved, ThreadPool *pool)
+{
+    double start = PerfCounter::now();
+    int i, node;
+
+    noRefitted = 0;
+    noRebuilt = 0;
+
+    if (!dynamic || noItems == 0)
+    {
+        if (!dynamic)
+            build(objects, noObjects, pool);
+        updateTime = PerfCounter::now() - start;
+        return;
+    }
+
+    this->pool = pool != NULL && pool->getNoThreads() > 1 ? pool : NULL;
+
+    int *changed = new int[noMoved];
+    int noChanged = 0;
+    for (i = 0; i < noMoved; i++)
+        if (leaves[moved[i]] >= 0 && boundObject(objects[moved[i]], moved[i]))
+            changed[noChanged++] = leaves[moved[i]];
+
+    for (i = 0; i < noChanged; i++)
+        refit(changed[i]);
+
+    for (i = 0; i < noChanged; i++)
+        for (node = changed[i]; node != 0; )
+        {
+            node = parents[node];
+            if (!refit(node))
+                break;
+        }
+
+    /* A node that is built again holds the others below it, which come
+     * after it.
+     */
+    int noWorst = 0;
+    for (i = 0; i < noChanged; i++)
+    {
+        int worst = -1;
+        for (node = changed[i]; node >= 0; node = parents[node])
+            if (nodes[node].count == 0 && costs[node] > BVH_REBUILD_GROWTH * builtCosts[node])
+                worst = node;
+
+        if (worst >= 0)
+            changed[noWorst++] = worst;
+    }
+    sort(changed, changed + noWorst);
+
+    int end = 0;
+    for (i = 0; i < noWorst; i++)
+    {
+        if (i > 0 && changed[i] < end)
+            continue;
+
+        int wide = openedBy != NULL ? openedBy[changed[i]] : -1;
+        node = rebuild(changed[i], end);
+
+        /* The cost of the nodes above it is lower now. */
+        int above;
+        for (above = node; above != 0; )
+        {
+            above = parents[above];
+            refit(above);
+        }
+
+        if (wideNodes != NULL)
+        {
+            if (node != changed[i])
+                wide = openedBy[node];
+            recollapse(wide);
+        }
+    }
+
+    delete [] changed;
+    updateTime = PerfCounter::now() - start;
+}
+
+/* Tells which children of the wide node the ray enters before limit, as
+ * the bits of a mask, and where it enters each. Along each axis, the side
+ * of the boxes the ray meets first is known from its direction, so the
+ * empty boxes, from FLT_MAX to -FLT_MAX, are never entered.
+ */
+static inline int enterChildren(const bvhWideNode &n, const float *origin, const float *inverse,
+                                const int *backwards, float limit, float *entry)
+{
+    const float *nearX = backwards[0] ? n.upper[0] : n.lower[0];
+    const float *farX = backwards[0] ? n.lower[0] : n.upper[0];
+    const float *nearY = backwards[1] ? n.upper[1] : n.lower[1];
+    const float *farY = backwards[1] ? n.lower[1] : n.upper[1];
+    const float *nearZ = backwards[2] ? n.upper[2] : n.lower[2];
+    const float *farZ = backwards[2] ? n.lower[2] : n.upper[2];
+
+#ifdef __AVX__
+    __m256 oX = _mm256_set1_ps(origin[0]), iX = _mm256_set1_ps(inverse[0]);
+    __m256 oY = _mm256_set1_ps(origin[1]), iY = _mm256_set1_ps(inverse[1]);
+    __m256 oZ = _mm256_set1_ps(origin[2]), iZ = _mm256_set1_ps(inverse[2]);
+
+    __m256 tNear = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearX), oX), iX);
+    tNear = _mm256_max_ps(tNear, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearY), oY), iY));
+    tNear = _mm256_max_ps(tNear, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(nearZ), oZ), iZ));
+    __m256 tFar = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farX), oX), iX);
+    tFar = _mm256_min_ps(tFar, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farY), oY), iY));
+    tFar = _mm256_min_ps(tFar, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(farZ), oZ), iZ));
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ),
+                               _mm256_cmp_ps(tFar, _mm256_setzero_ps(), _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(tNear, _mm256_set1_ps(limit), _CMP_LE_OQ));
+
+    _mm256_storeu_ps(entry, tNear);
+    return _mm256_movemask_ps(hit);
+#elif defined(__SSE__)
+    __m128 oX = _mm_set1_ps(origin[0]), iX = _mm_set1_ps(inverse[0]);
+    __m128 oY = _mm_set1_ps(origin[1]), iY = _mm_set1_ps(inverse[1]);
+    __m128 oZ = _mm_set1_ps(origin[2]), iZ = _mm_set1_ps(inverse[2]);
+
+    __m128 tNear = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearX), oX), iX);
+    tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearY), oY), iY));
+    tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearZ), oZ), iZ));
+    __m128 tFar = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farX), oX), iX);
+    tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farY), oY), iY));
+    tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farZ), oZ), iZ));
+
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpge_ps(tFar, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(tNear, _mm_set1_ps(limit)));
+
+    _mm_storeu_ps(entry, tNear);
+    return _mm_movemask_ps(hit);
+#else
+    int i, mask = 0;
+
+    for (i = 0; i < BVH_WIDTH; i++)
+    {
+        float tNear = (nearX[i] - origin[0]) * inverse[0];
+        tNear = max(tNear, (nearY[i] - origin[1]) * inverse[1]);
+        tNear = max(tNear, (nearZ[i] - origin[2]) * inverse[2]);
+        float tFar = (farX[i] - origin[0]) * inverse[0];
+        tFar = min(tFar, (farY[i] - origin[1]) * inverse[1]);
+        tFar = min(tFar, (farZ[i] - origin[2]) * inverse[2]);
+
+        entry[i] = tNear;
+        if (tNear <= tFar && tFar >= 0 && tNear <= limit)
+            mask |= 1 << i;
+    }
+
+    return mask;
+#endif
+}
+
+/* The steps of a compressed node are read as numbers with AVX, as "make
+ * avx" builds, or with SSE2, as the makefile does otherwise; a build with
+ * neither reads them one at a time in enterCompressed().
+ */
+#ifdef __AVX__
+/* The steps of the sides of eight children, as numbers. */
+static inline __m256 stepsOf(const unsigned char *steps)
+{
+    __m128i bytes = _mm_loadl_epi64((const __m128i *) steps);
+    __m128i low = _mm_cvtepu8_epi32(bytes);
+    __m128i high = _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4));
+
+    return _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1));
+}
+#elif defined(__SSE2__)
+/* The steps of the sides of four children, as numbers. */
+static inline __m128 stepsOf(const unsigned char *steps)
+{
+    int bytes;
+    memcpy(&bytes, steps, sizeof(bytes));
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+}
+#endif
+
+/* As for a wide node, but the sides are kept in steps: the ray crosses the
+ * one at step q of an axis at q * (scale * inverse) + (origin - o) * inverse.
+ */
+static inline int enterCompressed(const bvhCompressedNode &n, const float *origin, const float *inverse,
+                                  const int *backwards, float limit, float *entry)
+{
+    float a[3], b[3];
+    int k;
+
+    for (k = 0; k < 3; k++)
+    {
+        a[k] = n.scale[k] * inverse[k];
+        b[k] = (n.origin[k] - origin[k]) * inverse[k];
+    }
+
+    const unsigned char *nearX = backwards[0] ? n.upper[0] : n.lower[0];
+    const unsigned char *farX = backwards[0] ? n.lower[0] : n.upper[0];
+    const unsigned char *nearY = backwards[1] ? n.upper[1] : n.lower[1];
+    const unsigned char *farY = backwards[1] ? n.lower[1] : n.upper[1];
+    const unsigned char *nearZ = backwards[2] ? n.upper[2] : n.lower[2];
+    const unsigned char *farZ = backwards[2] ? n.lower[2] : n.upper[2];
+
+#ifdef __AVX__
+    __m256 aX = _mm256_set1_ps(a[0]), bX = _mm256_set1_ps(b[0]);
+    __m256 aY = _mm256_set1_ps(a[1]), bY = _mm256_set1_ps(b[1]);
+    __m256 aZ = _mm256_set1_ps(a[2]), bZ = _mm256_set1_ps(b[2]);
+
+    __m256 tNear = _mm256_add_ps(_mm256_mul_ps(stepsOf(nearX), aX), bX);
+    tNear = _mm256_max_ps(tNear, _mm256_add_ps(_mm256_mul_ps(stepsOf(nearY), aY), bY));
+    tNear = _mm256_max_ps(tNear, _mm256_add_ps(_mm256_mul_ps(stepsOf(nearZ), aZ), bZ));
+    __m256 tFar = _mm256_add_ps(_mm256_mul_ps(stepsOf(farX), aX), bX);
+    tFar = _mm256_min_ps(tFar, _mm256_add_ps(_mm256_mul_ps(stepsOf(farY), aY), bY));
+    tFar = _mm256_min_ps(tFar, _mm256_add_ps(_mm256_mul_ps(stepsOf(farZ), aZ), bZ));
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ),
+                               _mm256_cmp_ps(tFar, _mm256_setzero_ps(), _CMP_GE_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(tNear, _mm256_set1_ps(limit), _CMP_LE_OQ));
+
+    _mm256_storeu_ps(entry, tNear);
+    return _mm256_movemask_ps(hit);
+#elif defined(__SSE2__)
+    __m128 aX = _mm_set1_ps(a[0]), bX = _mm_set1_ps(b[0]);
+    __m128 aY = _mm_set1_ps(a[1]), bY = _mm_set1_ps(b[1]);
+    __m128 aZ = _mm_set1_ps(a[2]), bZ = _mm_set1_ps(b[2]);
+
+    __m128 tNear = _mm_add_ps(_mm_mul_ps(stepsOf(nearX), aX), bX);
+    tNear = _mm_max_ps(tNear, _mm_add_ps(_mm_mul_ps(stepsOf(nearY), aY), bY));
+    tNear = _mm_max_ps(tNear, _mm_add_ps(_mm_mul_ps(stepsOf(nearZ), aZ), bZ));
+    __m128 tFar = _mm_add_ps(_mm_mul_ps(stepsOf(farX), aX), bX);
+    tFar = _mm_min_ps(tFar, _mm_add_ps(_mm_mul_ps(stepsOf(farY), aY), bY));
+    tFar = _mm_min_ps(tFar, _mm_add_ps(_mm_mul_ps(stepsOf(farZ), aZ), bZ));
+
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpge_ps(tFar, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(tNear, _mm_set1_ps(limit)));
+
+    _mm_storeu_ps(entry, tNear);
+    return _mm_movemask_ps(hit);
+#else
+    int i, mask = 0;
+
+    for (i = 0; i < BVH_WIDTH; i++)
+    {
+        float tNear = nearX[i] * a[0] + b[0];
+        tNear = max(tNear, nearY[i] * a[1] + b[1]);
+        tNear = max(tNear, nearZ[i] * a[2] + b[2]);
+        float tFar = farX[i] * a[0] + b[0];
+        tFar = min(tFar, farY[i] * a[1] + b[1]);
+        tFar = min(tFar, farZ[i] * a[2] + b[2]);
+
+        entry[i] = tNear;
+        if (tNear <= tFar && tFar >= 0 && tNear <= limit)
+            mask |= 1 << i;
+    }
+
+    return mask;
+#endif
+}
+
+/* The children hit, in the mask, sorted by where the ray enters them. */
+static inline int sortHits(int mask, const float *entry, int *hits)
+{
+    int i, k, noHits = 0;
+
+    for (i = 0; i < BVH_WIDTH; i++)
+        if (mask & (1 << i))
+        {
+            for (k = noHits++; k > 0 && entry[hits[k - 1]] > entry[i]; k--)
+                hits[k] = hits[k - 1];
+            hits[k] = i;
+        }
+
+    return noHits;
+}
+
+/* Tries the objects of a leaf. Of two at the same distance, the first one
+ * in the scene wins, as when all of them are tried in order.
+ */
+void BVH::intersectLeaf(int first, int count, Ray &ray, Object **objects,
+                        int &index, double &minT0, double &minT1, float &limit)
+{
+    int i;
+    double t0, t1;
+
+    for (i = first; i < first + count; i++)
+    {
+        int object = items[i];
+        if (objects[object]->intersects(ray, t0, t1) &&
+                (index == -1 || t0 < minT0 || (t0 == minT0 && object < index)))
+        {
+            minT0 = t0;
+            minT1 = t1;
+            index = object;
+            limit = (float) (minT0 * 1.00001);
+        }
+    }
+}
+
+/* Tries the objects of a leaf on a shadow ray, until one blocks it. */
+bool BVH::shadowLeaf(int first, int count, Ray &ray, Object **objects, bvhShadow &shadow)
+{
+    int i;
+
+    for (i = first; i < first + count; i++)
+        if (dimShadow(shadow, objects[items[i]], items[i], ray))
+            return true;
+
+    return false;
+}
+
+/* Builds the subtree of a lazy tree at the node, the first time a ray gets
+ * there, and gives its root. Only one thread builds it, in the room kept
+ * for it, and the others that get there meanwhile wait for it.
+ */
+int BVH::expand(int node)
+{
+    int i;
+    bvhSubtree &s = subtrees[nodes[node].offset];
+
+    if (s.state != SUBTREE_BUILT)
+    {
+        if (__sync_bool_compare_and_swap(&s.state, SUBTREE_UNBUILT, SUBTREE_BUILDING))
+        {
+            Arena arena;
+            bvhBuildNode *root = NULL;
+            int next = s.root;
+
+            buildSAH(s.first, s.count, s.depth, &root, arena, false);
+            flatten(root, next);
+            if (memberObjects != NULL)
+                for (i = s.first; i < s.first + s.count; i++)
+                    items[i] = memberObjects[items[i]];
+            __sync_fetch_and_add(&noNodes, next - s.root);
+            __sync_fetch_and_add(&noExpanded, 1);
+
+            /* The nodes must be written before the subtree is seen as built. */
+            __sync_synchronize();
+            s.state = SUBTREE_BUILT;
+        }
+        else
+            /* A subtree takes a while to build, and the thread building it
+             * may be waiting for the processor we would spin on.
+             */
+            while (s.state != SUBTREE_BUILT)
+            {
+                ThreadPool::yield();
+                __sync_synchronize();
+            }
+    }
+
+    /* And only read once it is seen as built. */
+    __sync_synchronize();
+    return s.root;
+}
+
+/* The objects of a subtree of a lazy tree that isn't built, one by one.
+ * They are still known by their place among the members.
+ */
+bool BVH::searchSubtree(bvhQuery &query, int subtree)
+{
+    const bvhSubtree &s = subtrees[subtree];
+    int i;
+
+    for (i = s.first; i < s.first + s.count; i++)
+    {
+        const bvhBox &box = boxes[items[i]];
+        int object = memberObjects != NULL ? memberObjects[items[i]] : items[i];
+
+        if (query.enters(box.lower, box.upper) && query.visit(object))
+            return true;
+    }
+
+    return false;
+}
+
+/* The nodes are taken from a stack, and opened if the query enters their
+ * box. A wide node tests the boxes of its children before they are
+ * stacked, and a leaf is stacked as its objects and their count.
+ */
+bool BVH::search(bvhQuery &query, bool build)
+{
+    int stack[BVH_WIDE_STACK_SIZE], stackCount[BVH_WIDE_STACK_SIZE];
+    int noStacked = 0;
+    int i, k, lane, node, count;
+    float lower[3], upper[3];
+
+    if (noItems == 0)
+        return false;
+
+    if (compressedNodes == NULL && wideNodes == NULL)
+    {
+        stack[noStacked++] = 0;
+        while (noStacked > 0)
+        {
+            node = stack[--noStacked];
+
+            /* Unless it is built, a subtree of a lazy tree is searched by
+             * its objects.
+             */
+            if (nodes[node].count < 0)
+            {
+                int subtree = nodes[node].offset;
+
+                if (build)
+                    node = expand(node);
+                else if (subtrees[subtree].state == SUBTREE_BUILT)
+                    node = subtrees[subtree].root;
+                else
+                {
+                    if (query.enters(nodes[node].lower, nodes[node].upper) && searchSubtree(query, subtree))
+                        return true;
+                    continue;
+                }
+            }
+
+            const bvhNode &n = nodes[node];
+            if (!query.enters(n.lower, n.upper))
+                continue;
+
+            if (n.count > 0)
+            {
+                for (i = n.offset; i < n.offset + n.count; i++)
+                    if (query.visit(items[i]))
+                        return true;
+                continue;
+            }
+
+            stack[noStacked++] = n.offset;
+            stack[noStacked++] = node + 1;
+        }
+
+        return false;
+    }
+
+    stack[0] = 0;
+    stackCount[0] = 0;
+    noStacked = 1;
+    while (noStacked > 0)
+    {
+        noStacked--;
+        node = stack[noStacked];
+        count = stackCount[noStacked];
+
+        if (count > 0)
+        {
+            for (i = node; i < node + count; i++)
+                if (query.visit(items[i]))
+                    return true;
+            continue;
+        }
+
+        for (lane = 0; lane < BVH_WIDTH; lane++)
+        {
+            int child, childCount;
+
+            if (compressedNodes != NULL)
+            {
+                const bvhCompressedNode &n = compressedNodes[node];
+                if (n.lower[0][lane] > n.upper[0][lane])
+                    continue;
+
+                for (k = 0; k < 3; k++)
+                {
+                    lower[k] = n.origin[k] + n.lower[k][lane] * n.scale[k];
+                    upper[k] = n.origin[k] + n.upper[k][lane] * n.scale[k];
+                }
+
+                int slot = n.slot[lane];
+                int place = slot & ((1 << BVH_SLOT_BITS) - 1);
+                childCount = slot >> BVH_SLOT_BITS;
+                child = childCount > 0 ? n.firstItem + place : n.firstChild + place;
+            }
+            else
+            {
+                const bvhWideNode &n = wideNodes[node];
+                if (n.count[lane] < 0)
+                    continue;
+
+                for (k = 0; k < 3; k++)
+                {
+                    lower[k] = n.lower[k][lane];
+                    upper[k] = n.upper[k][lane];
+                }
+                child = n.child[lane];
+                childCount = n.count[lane];
+            }
+
+            if (query.enters(lower, upper))
+            {
+                stack[noStacked] = child;
+                stackCount[noStacked++] = childCount;
+            }
+        }
+    }
+
+    return false;
+}
+
+/* Only what the rays read is copied, for all the room a tree that is
+ * updated has, as its nodes are spread over it.
+ */
+BVH *BVH::replicate()
+{
+    if (lazy)
+        return NULL;
+
+    BVH *copy = new BVH(method, width, compressed, false);
+
+    copy->bounds = bounds;
+    copy->noItems = noItems;
+    copy->items = new int[noItems];
+    memcpy(copy->items, items, noItems * sizeof(int));
+    copy->noUnbounded = noUnbounded;
+    copy->unbounded = new int[noUnbounded];
+    memcpy(copy->unbounded, unbounded, noUnbounded * sizeof(int));
+
+    copy->noWideNodes = noWideNodes;
+    if (compressedNodes != NULL)
+    {
+        copy->compressedNodes = (bvhCompressedNode *) HugePages::allocate(noWideNodes * sizeof(bvhCompressedNode));
+        memcpy(copy->compressedNodes, compressedNodes, noWideNodes * sizeof(bvhCompressedNode));
+    }
+    else if (wideNodes != NULL)
+    {
+        copy->wideNodesSize = wideNodesSize;
+        copy->wideNodes = (bvhWideNode *) HugePages::allocate(wideNodesSize * sizeof(bvhWideNode));
+        memcpy(copy->wideNodes, wideNodes, wideNodesSize * sizeof(bvhWideNode));
+    }
+    else if (nodes != NULL)
+    {
+        copy->noNodes = noNodes;
+        copy->nodesSize = nodesSize;
+        copy->nodes = (bvhNode *) HugePages::allocate(nodesSize * sizeof(bvhNode));
+        memcpy(copy->nodes, nodes, nodesSize * sizeof(bvhNode));
+    }
+
+    return copy;
+}
+
+/* The closest hit is the same as if all the objects were tried in order. */
+int BVH::closest(Ray &ray, Object **objects, double &minT0, double &minT1)
+{
+    int i, index = -1;
+    double t0, t1;
+
+    minT0 = -1;
+    minT1 = -1;
+
+    for (i = 0; i < noUnbounded; i++)
+        if (objects[unbounded[i]]->intersects(ray, t0, t1) && (index == -1 || t0 < minT0))
+        {
+            minT0 = t0;
+            minT1 = t1;
+            index = unbounded[i];
+        }
+
+    return closer(ray, objects, index, minT0, minT1);
+}
+
+int BVH::closer(Ray &ray, Object **objects, int index, double &minT0, double &minT1)
+{
+    if (compressedNodes != NULL)
+        return traverseCompressed(ray, objects, index, minT0, minT1, NULL);
+    if (wideNodes != NULL)
+        return traverseWide(ray, objects, index, minT0, minT1, NULL);
+    if (noNodes > 0)
+        return traverse(ray, objects, index, minT0, minT1, NULL);
+
+    return index;
+}
+
+/* The objects with no box are tried first, as they are few and block most
+ * of the rays that hit them.
+ */
+bool BVH::occluded(Ray &ray, Object **objects, bvhShadow &shadow)
+{
+    int i;
+
+    for (i = 0; i < noUnbounded; i++)
+        if (dimShadow(shadow, objects[unbounded[i]], unbounded[i], ray))
+            return true;
+
+    return occludedByBoxes(ray, objects, shadow);
+}
+
+/* The traversals are the ones for the closest hit, which stop as soon as a
+ * leaf blocks the shadow ray.
+ */
+bool BVH::occludedByBoxes(Ray &ray, Object **objects, bvhShadow &shadow)
+{
+    double t0, t1;
+
+    if (compressedNodes != NULL)
+        traverseCompressed(ray, objects, -1, t0, t1, &shadow);
+    else if (wideNodes != NULL)
+        traverseWide(ray, objects, -1, t0, t1, &shadow);
+    else if (noNodes > 0)
+        traverse(ray, objects, -1, t0, t1, &shadow);
+
+    return shadow.transparency <= EPSLON;
+}
+
+int BVH::traverse(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow)
+{
+    point o = ray.getOrigin();
+    vector d = ray.getDir();
+    float origin[3] = {(float) o.x, (float) o.y, (float) o.z};
+    float inverse[3] = {inverseOf(d.x), inverseOf(d.y), inverseOf(d.z)};
+    float limit = shadow != NULL ? (float) (shadow->distance * 1.00001) :
+                  index == -1 ? FLT_MAX : (float) (minT0 * 1.00001);
+
+    /* The nodes still to visit, with where the ray enters them. */
+    int stack[BVH_STACK_SIZE];
+    float stackEntry[BVH_STACK_SIZE];
+    int noStacked = 0;
+    float entry, entry2;
+    int node = 0;
+
+    if (!enterBox(nodes[0], origin, inverse, limit, entry))
+        return index;
+
+    for (;;)
+    {
+        if (nodes[node].count < 0)
+            node = expand(node);
+
+        const bvhNode &n = nodes[node];
+
+        if (n.count > 0)
+        {
+            if (shadow == NULL)
+                intersectLeaf(n.offset, n.count, ray, objects, index, minT0, minT1, limit);
+            else if (shadowLeaf(n.offset, n.count, ray, objects, *shadow))
+                return index;
+        }
+        else
+        {
+            int first = node + 1, second = n.offset;
+            bool hitFirst = enterBox(nodes[first], origin, inverse, limit, entry);
+            bool hitSecond = enterBox(nodes[second], origin, inverse, limit, entry2);
+
+            /* The nearest child first, and the other one later. */
+            if (hitFirst && hitSecond)
+            {
+                if (entry2 < entry)
+                {
+                    swap(first, second);
+                    swap(entry, entry2);
+                }
+                stack[noStacked] = second;
+                stackEntry[noStacked++] = entry2;
+                node = first;
+                continue;
+            }
+            if (hitFirst || hitSecond)
+            {
+                node = hitFirst ? first : second;
+                continue;
+            }
+        }
+
+        /* The next node left, unless the ray already hit something nearer. */
+        do
+        {
+            if (noStacked == 0)
+                return index;
+            noStacked--;
+        } while (stackEntry[noStacked] > limit);
+
+        node = stack[noStacked];
+    }
+}
+
+/* The children the ray enters are visited from the nearest one, and the
+ * rest are stacked so the nearer ones come out first. A leaf is stacked as
+ * its objects and their count.
+ */
+int BVH::traverseWide(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow)
+{
+    point o = ray.getOrigin();
+    vector d = ray.getDir();
+    float origin[3] = {(float) o.x, (float) o.y, (float) o.z};
+    float inverse[3] = {inverseOf(d.x), inverseOf(d.y), inverseOf(d.z)};
+    int backwards[3] = {inverse[0] < 0, inverse[1] < 0, inverse[2] < 0};
+    float limit = shadow != NULL ? (float) (shadow->distance * 1.00001) :
+                  index == -1 ? FLT_MAX : (float) (minT0 * 1.00001);
+
+    int stack[BVH_WIDE_STACK_SIZE], stackCount[BVH_WIDE_STACK_SIZE];
+    float stackEntry[BVH_WIDE_STACK_SIZE];
+    int noStacked = 0;
+    float entry[BVH_WIDTH];
+    int hits[BVH_WIDTH];
+    int k, node = 0, count = 0;
+
+    for (;;)
+    {
+        if (count > 0)
+        {
+            if (shadow == NULL)
+                intersectLeaf(node, count, ray, objects, index, minT0, minT1, limit);
+            else if (shadowLeaf(node, count, ray, objects, *shadow))
+                return index;
+        }
+        else
+        {
+            const bvhWideNode &n = wideNodes[node];
+            int mask = enterChildren(n, origin, inverse, backwards, limit, entry);
+
+            if (mask != 0)
+            {
+                int noHits = sortHits(mask, entry, hits);
+                for (k = noHits - 1; k > 0; k--)
+                {
+                    stack[noStacked] = n.child[hits[k]];
+                    stackCount[noStacked] = n.count[hits[k]];
+                    stackEntry[noStacked++] = entry[hits[k]];
+                }
+                node = n.child[hits[0]];
+                count = n.count[hits[0]];
+                continue;
+            }
+        }
+
+        do
+        {
+            if (noStacked == 0)
+                return index;
+            noStacked--;
+        } while (stackEntry[noStacked] > limit);
+
+        node = stack[noStacked];
+        count = stackCount[noStacked];
+    }
+}
+
+/* As for a wide tree, but each child is found from its slot. */
+int BVH::traverseCompressed(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow)
+{
+    point o = ray.getOrigin();
+    vector d = ray.getDir();
+    float origin[3] = {(float) o.x, (float) o.y, (float) o.z};
+    float inverse[3] = {inverseOf(d.x), inverseOf(d.y), inverseOf(d.z)};
+    int backwards[3] = {inverse[0] < 0, inverse[1] < 0, inverse[2] < 0};
+    float limit = shadow != NULL ? (float) (shadow->distance * 1.00001) :
+                  index == -1 ? FLT_MAX : (float) (minT0 * 1.00001);
+
+    int stack[BVH_WIDE_STACK_SIZE], stackCount[BVH_WIDE_STACK_SIZE];
+    float stackEntry[BVH_WIDE_STACK_SIZE];
+    int noStacked = 0;
+    float entry[BVH_WIDTH];
+    int hits[BVH_WIDTH];
+    int k, node = 0, count = 0;
+
+    for (;;)
+    {
+        if (count > 0)
+        {
+            if (shadow == NULL)
+                intersectLeaf(node, count, ray, objects, index, minT0, minT1, limit);
+            else if (shadowLeaf(node, count, ray, objects, *shadow))
+                return index;
+        }
+        else
+        {
+            const bvhCompressedNode &n = compressedNodes[node];
+            int mask = enterCompressed(n, origin, inverse, backwards, limit, entry);
+
+            if (mask != 0)
+            {
+                /* All the children hit are stacked, and the nearest one is
+                 * taken back at once.
+                 */
+                int noHits = sortHits(mask, entry, hits);
+                for (k = noHits - 1; k >= 0; k--)
+                {
+                    int slot = n.slot[hits[k]];
+                    int place = slot & ((1 << BVH_SLOT_BITS) - 1);
+
+                    stackCount[noStacked] = slot >> BVH_SLOT_BITS;
+                    stack[noStacked] = (slot >> BVH_SLOT_BITS) > 0 ? n.firstItem + place : n.firstChild + place;
+                    stackEntry[noStacked++] = entry[hits[k]];
+                }
+                noStacked--;
+                node = stack[noStacked];
+                count = stackCount[noStacked];
+                continue;
+            }
+        }
+
+        do
+        {
+            if (noStacked == 0)
+                return index;
+            noStacked--;
+        } while (stackEntry[noStacked] > limit);
+
+        node = stack[noStacked];
+        count = stackCount[noStacked];
+    }
+}
+
+int BVH::getMethod() { return method; }
+int BVH::getWidth() { return width; }
+bool BVH::isCompressed() { return compressed; }
+bool BVH::isDynamic() { return dynamic; }
+bool BVH::isLazy() { return lazy; }
+int BVH::getNoSubtrees() { return lazy ? noSubtrees : 0; }
+int BVH::getNoExpanded() { return noExpanded; }
+
+/* A lazy tree is binary, and so is never compressed. */
+void BVH::setLazy(bool lazy)
+{
+    this->lazy = lazy && !dynamic;
+    if (this->lazy)
+    {
+        width = 2;
+        compressed = false;
+    }
+}
+
+bool BVH::getBounds(bvhBox &box)
+{
+    box = bounds;
+    return noItems > 0;
+}
+int BVH::getNoNodes() { return wideNodes != NULL || compressedNodes != NULL ? noWideNodes : noNodes; }
+double BVH::getBuildTime() { return buildTime; }
+int BVH::getNoRefitted() { return noRefitted; }
+int BVH::getNoRebuilt() { return noRebuilt; }
+double BVH::getUpdateTime() { return updateTime; }
+
+size_t BVH::getSize()
+{
+    size_t size = (size_t) (noItems + noUnbounded) * sizeof(int);
+
+    if (compressedNodes != NULL)
+        size += noWideNodes * sizeof(bvhCompressedNode);
+    if (wideNodes != NULL)
+        size += noWideNodes * sizeof(bvhWideNode);
+    if (nodes != NULL)
+        size += noNodes * sizeof(bvhNode);
+
+    /* What a tree that is updated keeps, for all the room it has. */
+    if (dynamic)
+    {
+        size += noObjects * (sizeof(bvhBox) + 3 * sizeof(float) + sizeof(int));
+        size += 2 * (size_t) noItems * 3 * sizeof(int);
+        if (wideNodes != NULL)
+            size += 2 * (size_t) noItems * 2 * sizeof(int) + wideNodesSize * 4 * sizeof(int);
+    }
+
+    return size;
+}
@@ -0,0 +1,400 @@
+#ifndef _H_BVH
+#define _H_BVH
+
+/* Needed libraries. */
+#include <stddef.h>
+#include <cmath>
+#include <algorithm>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Object.h"
+#include "Ray.h"
+#include "Arena.h"
+#include "ThreadPool.h"
+
+/* How the tree is built: with no tree, every object is tried by each ray;
+ * with the surface area heuristic, the best tree for tracing; with the
+ * Morton codes of the objects, a worse tree made much faster.
+ */
+#define BVH_NONE 0
+#define BVH_SAH 1
+#define BVH_LBVH 2
+
+/* The bins each node is split among, and the most objects in a leaf. */
+#define BVH_BINS 16
+#define BVH_LEAF_SIZE 4
+
+/* The nodes with fewer objects than this are binned by a single thread. */
+#define BVH_PARALLEL_BINNING 65536
+
+/* A lazy tree builds the nodes with more objects than this at once, and the
+ * subtrees below them only when a ray first reaches them.
+ */
+#define BVH_LAZY_SUBTREE 2048
+
+/* A box, by its lowest and highest corners. */
+struct bvhBox
+{
+    float lower[3], upper[3];
+};
+
+/* A node of the tree, in 32 bytes. A leaf holds count objects from offset,
+ * in the list of objects of the tree. Any other node has count 0; its first
+ * child follows it, and offset is its second one.
+ */
+struct bvhNode
+{
+    float lower[3];
+    int count;
+    float upper[3];
+    int offset;
+};
+
+/* A node while the tree is being built. */
+struct bvhBuildNode
+{
+    bvhBuildNode *children[2];
+    int first, count;
+};
+
+/* A subtree left to a thread, and where it goes in the tree. */
+struct bvhSubtree;
+
+/* The deepest a tree may be: past BVH_MAX_DEPTH, the objects of a node are
+ * split in two halves, so no more than 32 levels are added.
+ */
+#define BVH_MAX_DEPTH 64
+#define BVH_STACK_SIZE 128
+
+/* The children of a wide node: eight with AVX, which tests all their boxes
+ * at once, or else four, as SSE does. The nodes are laid out for one width,
+ * so it is chosen when the program is built: "make avx" gives eight.
+ */
+#ifdef __AVX__
+#define BVH_WIDTH 8
+#else
+#define BVH_WIDTH 4
+#endif
+#define BVH_WIDE_STACK_SIZE (BVH_STACK_SIZE * BVH_WIDTH)
+
+/* Where the ray enters the box of the node, if it does before limit. The
+ * directions with no component along an axis are given a tiny one, so no
+ * division gives an undefined number.
+ */
+inline bool enterBox(const bvhNode &n, const float *origin, const float *inverse, float limit, float &entry)
+{
+    float t0 = (n.lower[0] - origin[0]) * inverse[0];
+    float t1 = (n.upper[0] - origin[0]) * inverse[0];
+    float tNear = std::min(t0, t1), tFar = std::max(t0, t1);
+
+    t0 = (n.lower[1] - origin[1]) * inverse[1];
+    t1 = (n.upper[1] - origin[1]) * inverse[1];
+    tNear = std::max(tNear, std::min(t0, t1));
+    tFar = std::min(tFar, std::max(t0, t1));
+
+    t0 = (n.lower[2] - origin[2]) * inverse[2];
+    t1 = (n.upper[2] - origin[2]) * inverse[2];
+    tNear = std::max(tNear, std::min(t0, t1));
+    tFar = std::min(tFar, std::max(t0, t1));
+
+    if (tFar < 0 || tNear > tFar || tNear > limit)
+        return false;
+
+    entry = tNear;
+    return true;
+}
+
+inline float inverseOf(double d)
+{
+    if (std::fabs(d) < 1e-20)
+        d = d < 0 ? -1e-20 : 1e-20;
+
+    return (float) (1.0 / d);
+}
+
+/* The steps each side of a compressed box may be at, and the bits of the
+ * slot of each child kept for its place among the others.
+ */
+#define BVH_QUANTA 255
+#define BVH_SLOT_BITS 5
+
+/* A subtree whose cost, by the surface area heuristic, grew by more than
+ * this since it was built is built again when the tree is updated.
+ */
+#define BVH_REBUILD_GROWTH 1.5f
+
+/* A node of the wide tree, which takes the place of a few levels of the
+ * binary one. The boxes of its children are kept by axis and side, so the
+ * same coordinate of all of them is read at once. A child with count 0 is
+ * another wide node, one with a higher count is a leaf of count objects
+ * from child, and the unused ones have boxes no ray enters.
+ */
+struct bvhWideNode
+{
+    float lower[3][BVH_WIDTH];
+    float upper[3][BVH_WIDTH];
+    int child[BVH_WIDTH];
+    int count[BVH_WIDTH];
+};
+
+/* A wide node in less than half the memory. The boxes of its children are
+ * kept in steps of scale from origin, the lowest corner of the node, as
+ * bytes, rounded out so they never shrink. Its children that are nodes come
+ * one after the other from firstChild, and the objects of its leaves from
+ * firstItem. So the slot of each child is one byte: the count of objects of
+ * a leaf, or 0, in the highest bits, and its place in the lowest ones.
+ */
+struct bvhCompressedNode
+{
+    float origin[3], scale[3];
+    int firstChild, firstItem;
+    unsigned char lower[3][BVH_WIDTH];
+    unsigned char upper[3][BVH_WIDTH];
+    unsigned char slot[BVH_WIDTH];
+    unsigned char padding[BVH_WIDTH];
+};
+
+/* A ray to a light. It gets dimmed by the refraction of each object it
+ * goes through before the light, at distance, until it is blocked. The
+ * object it starts on, and the ones the light says cast no shadow, are left
+ * out. The last opaque object it hit is kept, so the next ray can try it
+ * first.
+ */
+struct bvhShadow
+{
+    double distance;
+    int self;
+    const bool *casts;
+    double transparency;
+    int blocker;
+};
+
+/* Dims the shadow ray by the object i, and tells if it is now blocked. */
+inline bool dimShadow(bvhShadow &shadow, Object *object, int i, Ray &ray)
+{
+    double t0, t1;
+
+    if (i == shadow.self || (shadow.casts != NULL && !shadow.casts[i]) ||
+            !object->intersects(ray, t0, t1) || t0 > shadow.distance)
+        return false;
+
+    shadow.transparency *= object->getRefraction();
+    if (object->getRefraction() == 0)
+        shadow.blocker = i;
+
+    return shadow.transparency <= EPSLON;
+}
+
+/* A search over the boxes of a tree: the nodes whose box it enters are
+ * opened, and each object in their leaves is visited, until a visit says
+ * the search is over.
+ */
+class bvhQuery
+{
+public:
+    virtual ~bvhQuery() { }
+    virtual bool enters(const float *lower, const float *upper) = 0;
+    virtual bool visit(int object) = 0;
+};
+
+/* Header for the BVH class. It is a bounding volume hierarchy: a tree of
+ * boxes, each around the objects of the nodes below it, so a ray only tries
+ * the objects inside the boxes it crosses. The planes have no box, so they
+ * stay out of the tree and every ray tries them. The tree is built by the
+ * threads of the pool: the nodes at the top are split one at a time, with
+ * the objects shared among the threads, and then each thread builds some of
+ * the subtrees below. Then, the binary tree may be made wide, so each node
+ * has up to BVH_WIDTH children, all tested together, and its nodes may be
+ * compressed. A tree that can be updated keeps what it needs to follow the
+ * objects as they move: the boxes above them are made to fit again, and only
+ * the parts of the tree that got much worse are built again. A lazy tree
+ * builds only its top at first, and each subtree below when a ray first
+ * enters it, so the parts of the scene no ray sees are never built.
+ */
+class BVH
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int method, width;
+    bool compressed, dynamic, lazy;
+
+    /* The nodes, the root first, and the objects of the leaves. A wide tree
+     * only keeps its wide nodes.
+     */
+    int noNodes, nodesSize;
+    bvhNode *nodes;
+    int noWideNodes, wideNodesSize;
+    bvhWideNode *wideNodes;
+    bvhCompressedNode *compressedNodes;
+    int noItems;
+    int *items;
+
+    /* The objects with no box. */
+    int noUnbounded;
+    int *unbounded;
+
+    /* While building: the box of each object and its centre, the subtrees
+     * left to the threads, and the Morton code of each object.
+     */
+    int noObjects;
+    bvhBox *boxes;
+    float (*centres)[3];
+    ThreadPool *pool;
+    int noSubtrees, subtreesSize, subtreeLimit;
+    bvhSubtree *subtrees;
+    unsigned long long *codes;
+    double buildTime;
+    bvhBox bounds;
+
+    /* Kept by a tree that can be updated, with the boxes and centres: the
+     * node above each one and its cost, now and when it was built, and the
+     * leaf of each object. For a wide tree, the binary node each wide node
+     * stands for, the one above it, and where the nodes below it were
+     * placed; and the wide node and child each binary node is, or the wide
+     * node that opened it.
+     */
+    int *parents;
+    float *costs, *builtCosts;
+    int *leaves;
+    int *wideSources, *wideParents, *wideFirsts, *wideEnds;
+    int *laneOf, *openedBy;
+    int noRefitted, noRebuilt;
+    double updateTime;
+
+    /* The subtrees of a lazy tree built so far, and the members it was
+     * built over, as its subtrees still know the objects by their place
+     * among them.
+     */
+    int noExpanded;
+    int *memberObjects;
+
+    bool leaveSubtree(int first, int count, int depth, bvhBuildNode **slot);
+    bvhBuildNode *makeNode(int first, int count, Arena &arena);
+    void binObjects(int first, int count, int axis, float low, float scale,
+                    bvhBox &box, bvhBox &centreBox, bvhBox *binBoxes, int *binCounts);
+    void buildSAH(int first, int count, int depth, bvhBuildNode **slot, Arena &arena, bool top);
+    void buildLBVH(int first, int count, int depth, bvhBuildNode **slot, Arena &arena, bool top);
+    void sortCodes();
+    void runSubtrees();
+    void flatten(bvhBuildNode *node, int &next);
+    int openLanes(int node, int index, int *lanes);
+    int countWide(int node);
+    void collapse(int node, int index, int &next);
+    void compress();
+    void release();
+    void freeSubtrees();
+    bool boundObject(Object *object, int i);
+
+    int subtreeEnd(int node);
+    int countNodes(int node);
+    int liveWide(int index);
+    bool refit(int node);
+    void link(int first, int last);
+    int rebuild(int node, int &end);
+    void recollapse(int index);
+
+    int expand(int node);
+    bool searchSubtree(bvhQuery &query, int subtree);
+
+    void intersectLeaf(int first, int count, Ray &ray, Object **objects,
+                       int &index, double &minT0, double &minT1, float &limit);
+    bool shadowLeaf(int first, int count, Ray &ray, Object **objects, bvhShadow &shadow);
+    int traverse(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow);
+    int traverseWide(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow);
+    int traverseCompressed(Ray &ray, Object **objects, int index, double &minT0, double &minT1, bvhShadow *shadow);
+
+    static void *binTask(void *task);
+    static void *subtreeTask(void *task);
+    static void *codeTask(void *task);
+    static void *sortTask(void *task);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. The width is 2, for a binary tree, or
+     * BVH_WIDTH. A compressed tree is always wide, and can't be updated.
+     */
+    explicit BVH(int method, int width, bool compressed, bool dynamic);
+    ~BVH();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Builds the tree over the objects, with the threads of the pool, or
+     * with the calling thread if there is none.
+     */
+    void build(Object **objects, int noObjects, ThreadPool *pool);
+    /* Builds the tree over some of the objects only, the members. Such a
+     * tree can't be updated.
+     */
+    void build(Object **objects, const int *members, int noMembers, ThreadPool *pool);
+    /* Follows the objects moved since the tree was built or last updated.
+     * A tree that can't be updated is built again.
+     */
+    void update(Object **objects, const int *moved, int noMoved, ThreadPool *pool);
+
+    /* Finds the closest object hit by the ray, or -1 if there is none, as
+     * trying every object would. The objects are the ones the tree was
+     * built on, or a copy of them.
+     */
+    int closest(Ray &ray, Object **objects, double &minT0, double &minT1);
+    /* The same, without the objects with no box, for a ray that already hit
+     * the object index, or -1, at minT0. Gives the closer one it hits.
+     */
+    int closer(Ray &ray, Object **objects, int index, double &minT0, double &minT1);
+
+    /* Dims the shadow ray by every object it goes through, and returns true
+     * once it is blocked, without looking any further. No box beyond the
+     * light is opened.
+     */
+    bool occluded(Ray &ray, Object **objects, bvhShadow &shadow);
+    /* The same, without the objects with no box. */
+    bool occludedByBoxes(Ray &ray, Object **objects, bvhShadow &shadow);
+
+    /* Visits the objects in the boxes the query enters, and returns true if
+     * a visit ended it. The objects with no box are left out. A lazy tree
+     * builds the subtrees the query enters if build is true, or else visits
+     * all of their objects.
+     */
+    bool search(bvhQuery &query, bool build);
+
+    /* A copy of the built tree that can only be traced, made in memory
+     * taken by the calling thread, so it is close to the processor it runs
+     * on. Returns NULL for a lazy tree, which goes on growing as it is
+     * traced.
+     */
+    BVH *replicate();
+
+    /* The box of the object, a little larger, and its centre if centre is
+     * not NULL. Returns false if it has none.
+     */
+    static bool boxOf(Object *object, bvhBox &box, float *centre);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getMethod();
+    int getWidth();
+    bool isCompressed();
+    bool isDynamic();
+    bool isLazy();
+    /* The box of all the objects in the tree. Returns false if it is empty. */
+    bool getBounds(bvhBox &box);
+    int getNoNodes();
+    /* The memory of the nodes and of the objects of the leaves. */
+    size_t getSize();
+    /* In seconds. */
+    double getBuildTime();
+    /* The nodes made to fit and the subtrees built again by the last update,
+     * and how long it took.
+     */
+    int getNoRefitted();
+    int getNoRebuilt();
+    double getUpdateTime();
+    /* The subtrees of a lazy tree, and how many were built by the rays. */
+    int getNoSubtrees();
+    int getNoExpanded();
+
+    /* Before it is built, makes the tree lazy: only its top is built, and
+     * the rest as the rays get there, so the first ones are traced sooner.
+     * A lazy tree is binary, and one that can be updated is never lazy.
+     */
+    void setLazy(bool lazy);
+};
+
+#endif
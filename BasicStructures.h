@@ -1 +1,292 @@
-#ifndef _BASIC_STRUCTURES_H#define _BASIC_STRUCTURES_H/* The defines used all over the program.*//* This value must be used due to precision errors. */#define EPSLON 0.00000001#define NEPER 2.718281828459045/* The depth of the ray tracing algorithm and finally the configuration of the * screen. */#define SCREEN_W 1600#define SCREEN_H 1200#define MAX_DEPTH 3//OTHER VALUES 5000 and 15000/* The different types of visualization. */#define LOOKING_AHEAD 1#define LOOKING_DOWN 2#define LOOKING_UP 3#define LOOKING_BACK 4#define LOOKING_RIGHT 5#define LOOKING_LEFT 6/* Declarations of some functions. */void buildScene(int no);void *renderImage(void *type);/* The struct that defines a given point. */struct point{    double x, y, z;	    point& operator += (const point &p2)    {        this->x += p2.x;        this->y += p2.y;        this->z += p2.z;        return *this;    }};/* The struct that defines a given vector. */struct vector{    double x, y, z;    vector& operator += (const vector &v2)    {	this->x += v2.x;        this->y += v2.y;        this->z += v2.z;        return *this;    }	    vector& operator /= (double c)    {        this->x /= c;        this->y /= c;        this->z /= c;        return *this;    }};/* Redefinition of operations over points. */inline point operator * (double t, const point &p){    point p2 = {p.x * t, p.y * t, p.z * t};    return p2;}inline double operator * (const point &p, const point &p2){    double t = p.x * p2.x + p.y * p2.y + p.z * p2.z;    return t;}inline vector operator - (const point &p1, const point &p2){    vector v = {p1.x - p2.x, p1.y - p2.y, p1.z - p2.z };    return v;}/* Redefinition of operations involving points and vectors. */inline point operator + (const point &p, const vector &v){    point p2 = {p.x + v.x, p.y + v.y, p.z + v.z };    return p2;}inline point operator - (const point &p, const vector &v){    point p2 = {p.x - v.x, p.y - v.y, p.z - v.z };    return p2;}/* Redefinition of operations over vectors. */inline vector operator + (const vector &v1, const vector &v2){    vector v = {v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };    return v;}inline vector operator * (double c, const vector &v){    vector v2 = {v.x *c, v.y * c, v.z * c };    return v2;}inline double operator * (const point &c, const vector &v){    double d = v.x *c.x + v.y * c.y + v.z * c.z ;    return d;}inline vector operator / (double c, const vector &v){    vector v2 = {v.x / c, v.y / c, v.z / c };    return v2;}inline vector operator - (const vector &v1, const vector &v2){    vector v = {v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };    return v;}inline double operator * (const vector &v1, const vector &v2 ){    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;}/* The struct that the defines a given colour. */struct colour{    double r, g, b;    inline colour & operator += (const colour &c2 )    {        this->r +=  c2.r;        this->g += c2.g;        this->b += c2.b;        return *this;    }    inline colour & operator = (double t )    {        this->r =  t;        this->g = t;        this->b = t;        return *this;    }};/* Redefinition of operations over colours. */inline colour operator * (const colour &c1, const colour &c2 ){    colour c = {c1.r * c2.r, c1.g * c2.g, c1.b * c2.b};    return c;}inline colour operator + (const colour &c1, const colour &c2 ){    colour c = {c1.r + c2.r, c1.g + c2.g, c1.b + c2.b};    return c;}inline colour operator * (double coef, const colour &c ){    colour c2 = {c.r * coef, c.g * coef, c.b * coef};    return c2;}inline colour operator / (const colour &c, double coef){    colour c2 = {c.r / coef, c.g / coef, c.b / coef};    return c2;}#endif
\ No newline at end of file
+#ifndef _BASIC_STRUCTURES_H
+#define _BASIC_STRUCTURES_H
+
+/* The defines used all over the program.*/
+
+/* This value must be used due to precision errors. */
+#define EPSLON 0.00000001
+#define NEPER 2.718281828459045
+
+/* The default depth of the ray tracing algorithm and finally the
+ * configuration of the screen.
+ */
+#define SCREEN_W 1600
+#define SCREEN_H 1200
+#define MAX_DEPTH 3
+
+/* The size, in pixels, of the square tiles in which the image is traced, and
+ * the most rays traced together, which is a tile with a border of one pixel.
+ */
+#define TILE_SIZE 16
+#define MAX_BATCH ((TILE_SIZE + 2) * (TILE_SIZE + 2))
+
+//OTHER VALUES 5000 and 15000
+
+/* The different types of visualization. */
+#define LOOKING_AHEAD 1
+#define LOOKING_DOWN 2
+#define LOOKING_UP 3
+#define LOOKING_BACK 4
+#define LOOKING_RIGHT 5
+#define LOOKING_LEFT 6
+
+/* The patterns in which the samples of a pixel are placed. */
+#define SAMPLER_STRATIFIED 1
+#define SAMPLER_HALTON 2
+#define SAMPLER_BLUE_NOISE 3
+
+/* The filters that turn the pixels of the image into the output. */
+#define FILTER_BOX 1
+#define FILTER_TENT 2
+
+/* The kinds of objects, as they are sent to another process. */
+#define OBJECT_SPHERE 1
+#define OBJECT_PLANE 2
+#define OBJECT_PLANE_CHESS 3
+#define OBJECT_CUBE 4
+#define OBJECT_TRIANGLE 5
+
+/* The frames of one turn of the animated spheres, and the radius of it. */
+#define ANIMATION_FRAMES 24
+#define ANIMATION_RADIUS 100.0
+
+/* Defines the needed classes. */
+class Ray;
+class Message;
+class Object;
+class Arena;
+struct colour;
+struct bvhBox;
+class BVH;
+class TopLevelBVH;
+
+/* Declarations of some functions. */
+void buildScene(int no);
+void buildShadowOccluders();
+void buildAccelerator();
+int animatedObjects(int *animated);
+int animateScene(int frame, int *moved);
+void updateAccelerator(const int *moved, int noMoved);
+void updateShadowOccluders(const int *moved, int noMoved, const bvhBox *before);
+void packScene(Message &m);
+bool unpackScene(Message &m);
+void freeScene();
+Object **copyObjects(Arena &arena);
+void *renderImage(void *id);
+void startRender();
+void finishRender();
+void storeTile(int x, int y, int width, int height, colour *pixels);
+
+/* The struct that defines a given point. */
+struct point
+{
+    double x, y, z;
+	
+    point& operator += (const point &p2)
+    {
+        this->x += p2.x;
+        this->y += p2.y;
+        this->z += p2.z;
+        return *this;
+    }
+};
+
+/* The struct that defines a given vector. */
+struct vector
+{
+    double x, y, z;
+
+    vector& operator += (const vector &v2)
+    {
+	this->x += v2.x;
+        this->y += v2.y;
+        this->z += v2.z;
+        return *this;
+    }
+	
+    vector& operator /= (double c)
+    {
+        this->x /= c;
+        this->y /= c;
+        this->z /= c;
+        return *this;
+    }
+};
+
+/* Redefinition of operations over points. */
+inline point operator * (double t, const point &p)
+{
+    point p2 = {p.x * t, p.y * t, p.z * t};
+    return p2;
+}
+
+inline double operator * (const point &p, const point &p2)
+{
+    double t = p.x * p2.x + p.y * p2.y + p.z * p2.z;
+    return t;
+}
+
+inline vector operator - (const point &p1, const point &p2)
+{
+    vector v = {p1.x - p2.x, p1.y - p2.y, p1.z - p2.z };
+    return v;
+}
+
+/* Redefinition of operations involving points and vectors. */
+
+inline point operator + (const point &p, const vector &v)
+{
+    point p2 = {p.x + v.x, p.y + v.y, p.z + v.z };
+    return p2;
+}
+
+inline point operator - (const point &p, const vector &v)
+{
+    point p2 = {p.x - v.x, p.y - v.y, p.z - v.z };
+    return p2;
+}
+
+/* Redefinition of operations over vectors. */
+inline vector operator + (const vector &v1, const vector &v2)
+{
+    vector v = {v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
+    return v;
+}
+
+inline vector operator * (double c, const vector &v)
+{
+    vector v2 = {v.x *c, v.y * c, v.z * c };
+    return v2;
+}
+
+inline double operator * (const point &c, const vector &v)
+{
+    double d = v.x *c.x + v.y * c.y + v.z * c.z ;
+    return d;
+}
+
+inline vector operator / (double c, const vector &v)
+{
+    vector v2 = {v.x / c, v.y / c, v.z / c };
+    return v2;
+}
+
+inline vector operator - (const vector &v1, const vector &v2)
+{
+    vector v = {v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
+    return v;
+}
+
+inline double operator * (const vector &v1, const vector &v2 )
+{
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+
+/* The struct that the defines a given colour. */
+struct colour
+{
+    double r, g, b;
+
+    inline colour & operator += (const colour &c2 )
+    {
+        this->r +=  c2.r;
+        this->g += c2.g;
+        this->b += c2.b;
+        return *this;
+    }
+
+    inline colour & operator = (double t )
+    {
+        this->r =  t;
+        this->g = t;
+        this->b = t;
+        return *this;
+    }
+};
+
+/* Redefinition of operations over colours. */
+inline colour operator * (const colour &c1, const colour &c2 )
+{
+    colour c = {c1.r * c2.r, c1.g * c2.g, c1.b * c2.b};
+    return c;
+}
+
+inline colour operator + (const colour &c1, const colour &c2 )
+{
+    colour c = {c1.r + c2.r, c1.g + c2.g, c1.b + c2.b};
+    return c;
+}
+
+inline colour operator * (double coef, const colour &c )
+{
+    colour c2 = {c.r * coef, c.g * coef, c.b * coef};
+    return c2;
+}
+
+inline colour operator / (const colour &c, double coef)
+{
+    colour c2 = {c.r / coef, c.g / coef, c.b / coef};
+    return c2;
+}
+
+/* Everything a rendering thread keeps for itself, so it never has to be
+ * shared with the other threads.
+ */
+struct renderContext
+{
+    int id;
+
+    /* The node of the machine the thread runs on, and the objects and the
+     * tree it reads: the copies kept on that node, if there are some.
+     */
+    int node;
+    Object **objects;
+    BVH *bvh;
+    TopLevelBVH *topLevel;
+
+    /* For each light, the last object that blocked a shadow ray cast to it,
+     * or -1. The counters tell how often it blocks the next one too.
+     */
+    int *lastOccluder;
+    long long occluderHits, occluderMisses;
+
+    /* The primary rays of the tile being traced, the object each one hit
+     * (or -1), its direction and the normal at that point. Then, the shadow
+     * ray to each light and how much of that light gets through.
+     */
+    Ray *rays;
+    int *hits;
+    vector *oldDirs, *normals;
+    Ray *shadowRays;
+    double *transparency;
+    /* The refracted ray of each primary ray, if it has one. */
+    Ray *refracted;
+    bool *refracts;
+
+    /* The heap of the rays spawned by the primary ray being followed, with
+     * the depth of each.
+     */
+    Ray *pending;
+    int *pendingDepth;
+    int noPending;
+
+    /* The tile being rendered starts at (tileX, tileY). For each of its
+     * pixels, and for a border of one pixel around it, we keep the sum of
+     * the colours of its samples, how many they are and the object seen at
+     * its centre. Then, the pixels chosen to be refined.
+     */
+    int tileX, tileY;
+    colour *tileColour;
+    int *tileSamples;
+    int *tileIds;
+    int *refined;
+    long long samples;
+
+    /* How many rays were stopped before the maximum depth, and how many
+     * because the budget of their primary ray ran out.
+     */
+    long long earlyStops, budgetStops;
+};
+
+#endif
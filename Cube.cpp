@@ -1,8 +1,12 @@
 #include <stdio.h>
+#include <algorithm>
 /* Defines the needed classes and their headers. */
 #include "Cube.h"
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
+
+using namespace std;
 
 Cube::Cube(double x, double y, double z, double xSide, double ySide, double zSide, double rC, double gC, double bC)
 {
@@ -313,6 +317,64 @@ void Cube::intersectionPointNormal(Ray &ray, vector &normalInt)
     return;
 }
 
+/* The box that encloses the cube is given by its own vertixes. */
+bool Cube::getBounds(point &lower, point &upper)
+{
+    int i;
+
+    lower = vertixes[0];
+    upper = vertixes[0];
+
+    for (i = 1; i < 8; i++)
+    {
+        lower.x = min(lower.x, vertixes[i].x);
+        lower.y = min(lower.y, vertixes[i].y);
+        lower.z = min(lower.z, vertixes[i].z);
+        upper.x = max(upper.x, vertixes[i].x);
+        upper.y = max(upper.y, vertixes[i].y);
+        upper.z = max(upper.z, vertixes[i].z);
+    }
+
+    return true;
+}
+
+/* The vertixes move with the cube, and its normals stay the same. */
+void Cube::move(vector offset)
+{
+    int i;
+
+    centre = centre + offset;
+    for (i = 0; i < 8; i++)
+        vertixes[i] = vertixes[i] + offset;
+}
+
+int Cube::getType() { return OBJECT_CUBE; }
+
+/* The faces of the cube go as they are, so it needs no building. */
+void Cube::pack(Message &m)
+{
+    int i;
+
+    Object::pack(m);
+    for (i = 0; i < 6; i++)
+        m.putVector(normals[i]);
+    for (i = 0; i < 8; i++)
+        m.putPoint(vertixes[i]);
+    m.putDouble(maxSide);
+}
+
+void Cube::unpack(Message &m)
+{
+    int i;
+
+    Object::unpack(m);
+    for (i = 0; i < 6; i++)
+        normals[i] = m.getVector();
+    for (i = 0; i < 8; i++)
+        vertixes[i] = m.getPoint();
+    maxSide = m.getDouble();
+}
+
 /* Returns the normals of each face. */
 vector Cube::getNormalFront() {return normals[0];}
 vector Cube::getNormalBack() {return normals[4];}
@@ -0,0 +1,116 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "HugePages.h"
+
+bool HugePages::enabled = false;
+
+/* The size rounded up to whole huge pages. */
+static size_t roundUp(size_t size, size_t page)
+{
+    return (size + page - 1) / page * page;
+}
+
+#ifdef _WIN32
+/* Large pages are only given to a process holding the right to lock memory
+ * in place, which we ask for once.
+ */
+static bool lockPrivilege()
+{
+    static int held = -1;
+    HANDLE token;
+    TOKEN_PRIVILEGES privileges;
+
+    if (held >= 0)
+        return held == 1;
+
+    held = 0;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) &&
+        GetLastError() == ERROR_SUCCESS)
+        held = 1;
+
+    CloseHandle(token);
+    return held == 1;
+}
+
+void *HugePages::allocate(size_t size)
+{
+    SIZE_T large = GetLargePageMinimum();
+
+    if (enabled && large > 0 && lockPrivilege())
+    {
+        void *memory = VirtualAlloc(NULL, roundUp(size, large),
+                                    MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory != NULL)
+            return memory;
+    }
+
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void HugePages::release(void *memory, size_t size)
+{
+    if (memory != NULL)
+        VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+/* Windows only gives large pages when the memory is made. */
+void HugePages::advise(void *memory, size_t size) { }
+#else
+/* First, we ask for huge pages kept for them by the system. If there are
+ * none, the system may still put the memory on huge pages as it is used.
+ */
+void *HugePages::allocate(size_t size)
+{
+    void *memory;
+
+    size = roundUp(size, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+    if (enabled)
+    {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+            return memory;
+    }
+#endif
+
+    memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+
+    advise(memory, size);
+    return memory;
+}
+
+void HugePages::release(void *memory, size_t size)
+{
+    if (memory != NULL)
+        munmap(memory, roundUp(size, HUGE_PAGE_SIZE));
+}
+
+/* Only the huge pages wholly inside the memory may be asked for. */
+void HugePages::advise(void *memory, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+    size_t first = roundUp((size_t) memory, HUGE_PAGE_SIZE);
+    size_t last = ((size_t) memory + size) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    if (enabled && last > first)
+        madvise((void *) first, last - first, MADV_HUGEPAGE);
+#endif
+}
+#endif
+
+bool HugePages::isEnabled() { return enabled; }
+void HugePages::setEnabled(bool e) { enabled = e; }
@@ -0,0 +1,38 @@
+#ifndef _H_HugePages
+#define _H_HugePages
+
+/* Needed libraries. */
+#include <stddef.h>
+
+/* The size of a huge page. */
+#define HUGE_PAGE_SIZE (2 << 20)
+
+/* Header for the HugePages class. It gives the memory of the large arrays
+ * read at random while tracing, as the image, on pages of 2 MB instead of
+ * 4 KB, so far fewer of them are needed to reach it. When the system has
+ * no huge pages to give, the memory is on normal pages, and nothing else
+ * changes.
+ */
+class HugePages
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    static bool enabled;
+
+public:
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Memory for size bytes, filled with zeros, or NULL if there is none.
+     * It is given back with release(), with the same size.
+     */
+    static void *allocate(size_t size);
+    static void release(void *memory, size_t size);
+
+    /* Asks for huge pages under memory we already have. */
+    static void advise(void *memory, size_t size);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    static bool isEnabled();
+    static void setEnabled(bool e);
+};
+
+#endif
@@ -0,0 +1,517 @@
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines the needed classes and their headers. */
+#include "ImageWriter.h"
+
+/* The most rows written together. */
+#define ROWS_PER_WRITE 64
+
+/* The sizes of the window searched for repeated bytes, and of the table
+ * that finds them.
+ */
+#define DEFLATE_WINDOW 32768
+#define HASH_BITS 15
+
+/* The lengths and distances of the deflate format: the first value of each
+ * code and the number of extra bits that follow it.
+ */
+static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const int distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* The codes are written from their highest bit, the rest from the lowest. */
+static unsigned int reverseBits(unsigned int bits, int count)
+{
+    unsigned int reversed = 0;
+
+    while (count-- > 0)
+    {
+        reversed = (reversed << 1) | (bits & 1);
+        bits >>= 1;
+    }
+
+    return reversed;
+}
+
+static unsigned int crc32(const unsigned char *data, int size, unsigned int crc)
+{
+    static unsigned int table[256];
+    static bool built = false;
+    int i, k;
+
+    if (!built)
+    {
+        for (i = 0; i < 256; i++)
+        {
+            unsigned int c = i;
+            for (k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        built = true;
+    }
+
+    crc = ~crc;
+    for (i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static void putInt(unsigned char *out, unsigned int value)
+{
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+/* In the constructor, we find the format from the extension of the file. */
+ImageWriter::ImageWriter(const char *fileName, int width, int height, unsigned char *pixels, bool tent):
+    file(NULL),
+    width(width),
+    height(height),
+    pixels(pixels),
+    tent(tent),
+    band(NULL),
+    bandY(0),
+    rowsWritten(0),
+    raw(NULL),
+    packed(NULL),
+    packedSize(0),
+    bitBuffer(0),
+    bitCount(0),
+    hashTable(NULL),
+    adler(1)
+{
+    const char *extension = strrchr(fileName, '.');
+
+    if (extension != NULL && (strcmp(extension, ".png") == 0 || strcmp(extension, ".PNG") == 0))
+        format = IMAGE_PNG;
+    else if (extension != NULL && (strcmp(extension, ".ppm") == 0 || strcmp(extension, ".PPM") == 0))
+        format = IMAGE_PPM;
+    else
+        format = IMAGE_TGA;
+
+    this->fileName = new char[strlen(fileName) + 1];
+    strcpy(this->fileName, fileName);
+
+    /* Only the thread needs to know which tiles are done. There's room
+     * for every tile of the image, so the window never waits. A tile cut
+     * to the region comes in five parts at most: the one traced, and the
+     * four around it that aren't.
+     */
+    pixelsDone = NULL;
+    queue = NULL;
+    if (pixels != NULL)
+    {
+        pixelsDone = new int[height];
+        memset(pixelsDone, 0, height * sizeof(int));
+        queue = new TileQueue(5 * ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE));
+    }
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&arrived, NULL);
+
+    if (format == IMAGE_PNG)
+    {
+        raw = new unsigned char[ROWS_PER_WRITE * (width*3 + 1)];
+        /* Each byte takes 9 bits at most, plus the headers. */
+        packed = new unsigned char[ROWS_PER_WRITE * (width*3 + 1) * 9 / 8 + 64];
+        hashTable = new int[1 << HASH_BITS];
+    }
+}
+
+/* Destructor. */
+ImageWriter::~ImageWriter()
+{
+    delete [] fileName;
+    delete [] pixelsDone;
+    delete queue;
+    delete [] raw;
+    delete [] packed;
+    delete [] hashTable;
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&arrived);
+}
+
+bool ImageWriter::open()
+{
+    file = fopen(fileName, "wb");
+    if (file == NULL)
+        return false;
+
+    writeHeader();
+
+    return true;
+}
+
+bool ImageWriter::start()
+{
+    if (!open())
+        return false;
+
+    return pthread_create(&thread, NULL, run, this) == 0;
+}
+
+void ImageWriter::tileDone(tile t)
+{
+    queue->push(t);
+
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&arrived);
+    pthread_mutex_unlock(&mutex);
+}
+
+void ImageWriter::finish()
+{
+    pthread_join(thread, NULL);
+}
+
+/* The rows of TGA files go from the bottom of the image, as ours; those of
+ * PPM and PNG files from the top.
+ */
+int ImageWriter::imageRow(int f)
+{
+    return isBottomUp() ? f : height - 1 - f;
+}
+
+/* The row y comes from the whole output, or from the band. */
+unsigned char *ImageWriter::getRow(int y)
+{
+    if (pixels != NULL)
+        return &pixels[y * width * 3];
+
+    return &band[(y - bandY) * width * 3];
+}
+
+/* A row is ready once all its pixels are done. The tent filter also takes
+ * the rows above and below it.
+ */
+bool ImageWriter::rowReady(int y)
+{
+    if (pixelsDone[y] < width)
+        return false;
+
+    if (tent)
+    {
+        if (y > 0 && pixelsDone[y - 1] < width)
+            return false;
+        if (y < height - 1 && pixelsDone[y + 1] < width)
+            return false;
+    }
+
+    return true;
+}
+
+/* The thread waits for tiles, and writes all the rows they complete. */
+void *ImageWriter::run(void *writer)
+{
+    ImageWriter *w = (ImageWriter *) writer;
+    tile t;
+    int y, count;
+
+    while (w->rowsWritten < w->height)
+    {
+        pthread_mutex_lock(&w->mutex);
+        while (!w->queue->pop(t))
+            pthread_cond_wait(&w->arrived, &w->mutex);
+        pthread_mutex_unlock(&w->mutex);
+
+        for (y = t.y; y < t.y + t.height; y++)
+            w->pixelsDone[y] += t.width;
+
+        count = 0;
+        while (w->rowsWritten + count < w->height && count < ROWS_PER_WRITE &&
+                w->rowReady(w->imageRow(w->rowsWritten + count)))
+        {
+            count++;
+
+            if (count == ROWS_PER_WRITE)
+            {
+                w->writeRows(w->rowsWritten, count);
+                w->rowsWritten += count;
+                count = 0;
+            }
+        }
+
+        if (count > 0)
+        {
+            w->writeRows(w->rowsWritten, count);
+            w->rowsWritten += count;
+        }
+    }
+
+    w->close();
+    printf("Image written to %s.\n", w->fileName);
+
+    return NULL;
+}
+
+void ImageWriter::writeBand(unsigned char *rows, int y, int count)
+{
+    int first = isBottomUp() ? y : height - y - count;
+    int done;
+
+    band = rows;
+    bandY = y;
+
+    for (done = 0; done < count; done += ROWS_PER_WRITE)
+        writeRows(first + done, count - done < ROWS_PER_WRITE ? count - done : ROWS_PER_WRITE);
+}
+
+void ImageWriter::close()
+{
+    writeEnd();
+    fclose(file);
+    file = NULL;
+}
+
+bool ImageWriter::isBottomUp() { return format == IMAGE_TGA; }
+
+void ImageWriter::writeHeader()
+{
+    if (format == IMAGE_TGA)
+    {
+        /* No identification nor palette, uncompressed true colour, 24 bits
+         * per pixel, starting at the bottom left.
+         */
+        unsigned char header[18] = {0};
+        header[2] = 2;
+        header[12] = width & 0xff;
+        header[13] = width >> 8;
+        header[14] = height & 0xff;
+        header[15] = height >> 8;
+        header[16] = 24;
+        fwrite(header, 1, 18, file);
+    }
+    else if (format == IMAGE_PPM)
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+    else
+    {
+        unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+        unsigned char header[13];
+
+        /* 8 bits per channel, RGB, no interlacing. */
+        putInt(header, width);
+        putInt(header + 4, height);
+        header[8] = 8;
+        header[9] = 2;
+        header[10] = 0;
+        header[11] = 0;
+        header[12] = 0;
+
+        fwrite(signature, 1, 8, file);
+        writeChunk("IHDR", header, 13);
+
+        /* The stream starts with its own header: deflate, fastest level. */
+        packed[packedSize++] = 0x78;
+        packed[packedSize++] = 0x01;
+    }
+}
+
+/* Writes count rows, from the row first of the file. */
+void ImageWriter::writeRows(int first, int count)
+{
+    int f, j;
+
+    if (format == IMAGE_PPM)
+    {
+        for (f = first; f < first + count; f++)
+            fwrite(getRow(imageRow(f)), 1, width * 3, file);
+    }
+    else if (format == IMAGE_TGA)
+    {
+        /* TGA keeps the colours as BGR. */
+        unsigned char *row = new unsigned char[width * 3];
+
+        for (f = first; f < first + count; f++)
+        {
+            unsigned char *in = getRow(imageRow(f));
+
+            for (j = 0; j < width; j++)
+            {
+                row[j*3] = in[j*3 + 2];
+                row[j*3 + 1] = in[j*3 + 1];
+                row[j*3 + 2] = in[j*3];
+            }
+
+            fwrite(row, 1, width * 3, file);
+        }
+
+        delete [] row;
+    }
+    else
+    {
+        /* Each row starts with its filter. The Sub filter keeps the
+         * difference to the pixel on the left, which is often small.
+         */
+        int size = 0;
+
+        for (f = first; f < first + count; f++)
+        {
+            unsigned char *in = getRow(imageRow(f));
+
+            raw[size++] = 1;
+            for (j = 0; j < width * 3; j++)
+                raw[size++] = j < 3 ? in[j] : in[j] - in[j - 3];
+        }
+
+        /* The checksum of the stream covers the filtered rows. */
+        unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+        for (j = 0; j < size; j++)
+        {
+            s1 += raw[j];
+            s2 += s1;
+
+            if ((j & 4095) == 4095)
+            {
+                s1 %= 65521;
+                s2 %= 65521;
+            }
+        }
+        adler = (s2 % 65521) << 16 | (s1 % 65521);
+
+        deflateBlock(raw, size);
+        writeChunk("IDAT", packed, packedSize);
+        packedSize = 0;
+    }
+}
+
+void ImageWriter::writeEnd()
+{
+    if (format != IMAGE_PNG)
+        return;
+
+    /* An empty last block, the bits left and the checksum. */
+    putBits(1, 1);
+    putBits(1, 2);
+    putSymbol(256);
+    if (bitCount > 0)
+        putBits(0, 8 - bitCount);
+
+    putInt(&packed[packedSize], adler);
+    packedSize += 4;
+
+    writeChunk("IDAT", packed, packedSize);
+    writeChunk("IEND", NULL, 0);
+}
+
+void ImageWriter::writeChunk(const char *type, unsigned char *data, int size)
+{
+    unsigned char value[4];
+
+    putInt(value, size);
+    fwrite(value, 1, 4, file);
+    fwrite(type, 1, 4, file);
+    if (size > 0)
+        fwrite(data, 1, size, file);
+
+    putInt(value, crc32(data, size, crc32((const unsigned char *) type, 4, 0)));
+    fwrite(value, 1, 4, file);
+}
+
+void ImageWriter::putBits(unsigned int bits, int count)
+{
+    bitBuffer |= bits << bitCount;
+    bitCount += count;
+
+    while (bitCount >= 8)
+    {
+        packed[packedSize++] = bitBuffer & 0xff;
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+/* The fixed codes of deflate, for the literals, the lengths and the end of
+ * a block.
+ */
+void ImageWriter::putSymbol(int symbol)
+{
+    if (symbol < 144)
+        putBits(reverseBits(0x30 + symbol, 8), 8);
+    else if (symbol < 256)
+        putBits(reverseBits(0x190 + symbol - 144, 9), 9);
+    else if (symbol < 280)
+        putBits(reverseBits(symbol - 256, 7), 7);
+    else
+        putBits(reverseBits(0xc0 + symbol - 280, 8), 8);
+}
+
+void ImageWriter::putLength(int length)
+{
+    int code = 0;
+
+    while (code < 28 && lengthBase[code + 1] <= length)
+        code++;
+
+    putSymbol(257 + code);
+    putBits(length - lengthBase[code], lengthExtra[code]);
+}
+
+void ImageWriter::putDistance(int distance)
+{
+    int code = 0;
+
+    while (code < 29 && distanceBase[code + 1] <= distance)
+        code++;
+
+    putBits(reverseBits(code, 5), 5);
+    putBits(distance - distanceBase[code], distanceExtra[code]);
+}
+
+/* Compresses the data as a block with the fixed codes. Each sequence of
+ * three bytes is looked up once, in the place it was last seen, which is
+ * what the fastest level of zlib does as well.
+ */
+void ImageWriter::deflateBlock(unsigned char *data, int size)
+{
+    int i = 0, k;
+
+    for (k = 0; k < (1 << HASH_BITS); k++)
+        hashTable[k] = -1;
+
+    /* Not the last block, fixed codes. */
+    putBits(0, 1);
+    putBits(1, 2);
+
+    while (i < size)
+    {
+        int length = 0;
+
+        if (i + 3 <= size)
+        {
+            unsigned int key = (data[i] << 16 | data[i + 1] << 8 | data[i + 2]) * 2654435761u;
+            int h = key >> (32 - HASH_BITS);
+            int candidate = hashTable[h];
+            hashTable[h] = i;
+
+            if (candidate >= 0 && i - candidate <= DEFLATE_WINDOW)
+            {
+                int most = size - i < 258 ? size - i : 258;
+
+                while (length < most && data[candidate + length] == data[i + length])
+                    length++;
+
+                if (length >= 3)
+                {
+                    putLength(length);
+                    putDistance(i - candidate);
+                    i += length;
+                    continue;
+                }
+            }
+        }
+
+        putSymbol(data[i]);
+        i++;
+    }
+
+    putSymbol(256);
+}
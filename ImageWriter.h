@@ -0,0 +1,107 @@
+#ifndef _H_ImageWriter
+#define _H_ImageWriter
+
+/* Needed libraries. */
+#include <stdio.h>
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "TileQueue.h"
+
+/* The formats of the files the image can be written to. */
+#define IMAGE_TGA 1
+#define IMAGE_PPM 2
+#define IMAGE_PNG 3
+
+/* Header for the ImageWriter class. It writes the output of the image to a
+ * file while the image is still being traced. Each finished tile is handed
+ * to its own thread, which writes every row as soon as it and all the rows
+ * before it in the file are done. Without a thread, the rows may also be
+ * given in bands, in the order of the file.
+ */
+class ImageWriter
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* One of the IMAGE_ formats, found from the name of the file. */
+    int format;
+    char *fileName;
+    FILE *file;
+    int width, height;
+    /* The whole output, and if the tent filter is used on it. Or else, the
+     * band being written and its first row.
+     */
+    unsigned char *pixels;
+    bool tent;
+    unsigned char *band;
+    int bandY;
+
+    /* For each row of the image, how many of its pixels are done, and how
+     * many rows are already in the file.
+     */
+    int *pixelsDone;
+    int rowsWritten;
+
+    /* The finished tiles, and how the thread is woken when one arrives. */
+    TileQueue *queue;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t arrived;
+
+    /* For the PNG format: the filtered rows written together, the
+     * compressed stream, the bits not yet written, the last place of each
+     * sequence of three bytes and the checksum of the rows.
+     */
+    unsigned char *raw;
+    unsigned char *packed;
+    int packedSize;
+    unsigned int bitBuffer;
+    int bitCount;
+    int *hashTable;
+    unsigned int adler;
+
+    static void *run(void *writer);
+    int imageRow(int f);
+    unsigned char *getRow(int y);
+    bool rowReady(int y);
+    void writeHeader();
+    void writeRows(int first, int count);
+    void writeEnd();
+
+    /* The parts of the PNG format. */
+    void writeChunk(const char *type, unsigned char *data, int size);
+    void putBits(unsigned int bits, int count);
+    void putSymbol(int symbol);
+    void putLength(int length);
+    void putDistance(int distance);
+    void deflateBlock(unsigned char *data, int size);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit ImageWriter(const char *fileName, int width, int height, unsigned char *pixels, bool tent);
+    ~ImageWriter();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Opens the file and writes its header. Returns false on failure. */
+    bool open();
+    /* Opens the file and starts the thread. Returns false on failure. */
+    bool start();
+    /* Tells that the output of a tile is final. */
+    void tileDone(tile t);
+    /* Waits until the whole file is written. */
+    void finish();
+
+    /* Writes count rows, from the row y of the image, kept one after the
+     * other from the bottom in RGB. The bands must come in the order of the
+     * file, then close() ends it.
+     */
+    void writeBand(unsigned char *rows, int y, int count);
+    void close();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    /* If the file keeps the rows from the bottom of the image. */
+    bool isBottomUp();
+};
+
+#endif
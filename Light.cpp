@@ -1,13 +1,24 @@
 /* Defines the needed classes and their headers. */
 #include "Light.h"
+#include "Object.h"
+#include "Message.h"
 #include <cmath>
 
 extern long long fadingCoeficient;
 extern long long fullLightLimit;
+extern int noObjects;
+extern Object **objects;
 
 /* In the constructor, we set the centre and the colour of the light point. */
 Light::Light(double x, double y, double z, double in, double rC, double gC, double bC):
-	intensity(in)
+	intensity(in),
+	noOccluders(0),
+	occluders(NULL),
+	casts(NULL),
+	occluderCentres(NULL),
+	occluderRadii(NULL),
+	noUnbounded(0),
+	unbounded(NULL)
 {
     centre.x = x;
     centre.y = y;
@@ -17,9 +28,77 @@ Light::Light(double x, double y, double z, double in, double rC, double gC, doub
     c.b = bC;
 }
 
-Light::Light() { }
+Light::Light():
+	noOccluders(0),
+	occluders(NULL),
+	casts(NULL),
+	occluderCentres(NULL),
+	occluderRadii(NULL),
+	noUnbounded(0),
+	unbounded(NULL)
+{ }
 /* Destructor. */
-Light::~Light() {}
+Light::~Light()
+{
+    freeOccluders();
+}
+
+Light::Light(const Light &light):
+	centre(light.centre),
+	intensity(light.intensity),
+	c(light.c),
+	noOccluders(0),
+	occluders(NULL),
+	casts(NULL),
+	occluderCentres(NULL),
+	occluderRadii(NULL),
+	noUnbounded(0),
+	unbounded(NULL)
+{
+    copyOccluders(light);
+}
+
+Light &Light::operator = (const Light &light)
+{
+    if (this != &light)
+    {
+        centre = light.centre;
+        intensity = light.intensity;
+        c = light.c;
+        freeOccluders();
+        copyOccluders(light);
+    }
+
+    return *this;
+}
+
+void Light::copyOccluders(const Light &light)
+{
+    int k;
+
+    if (light.occluders == NULL)
+        return;
+
+    noUnbounded = light.noUnbounded;
+    unbounded = new int[noUnbounded];
+    for (k = 0; k < noUnbounded; k++)
+        unbounded[k] = light.unbounded[k];
+
+    casts = new bool[noObjects];
+    for (k = 0; k < noObjects; k++)
+        casts[k] = light.casts[k];
+
+    noOccluders = light.noOccluders;
+    occluders = new int[noOccluders];
+    occluderCentres = new point[noOccluders];
+    occluderRadii = new double[noOccluders];
+    for (k = 0; k < noOccluders; k++)
+    {
+        occluders[k] = light.occluders[k];
+        occluderCentres[k] = light.occluderCentres[k];
+        occluderRadii[k] = light.occluderRadii[k];
+    }
+}
 
 /* Returns centre and radius of the sphere. */
 point Light::getCentre() { return centre; }
@@ -46,3 +125,449 @@ double Light::getFade( double distance)
     
     return value > 1 ? 1 : value;
 }
+
+/* The sphere around a box, as wide as the box itself, so it holds the
+ * spheres around all the boxes inside it too.
+ */
+static void outerSphere(const float *lower, const float *upper, point &c, double &radius)
+{
+    vector diagonal;
+
+    c.x = 0.5 * (lower[0] + upper[0]);
+    c.y = 0.5 * (lower[1] + upper[1]);
+    c.z = 0.5 * (lower[2] + upper[2]);
+    diagonal.x = upper[0] - lower[0];
+    diagonal.y = upper[1] - lower[1];
+    diagonal.z = upper[2] - lower[2];
+    radius = sqrt(diagonal * diagonal);
+}
+
+/* Whether a receiver, by the sphere around it, enters the cone of the
+ * shadow of an occluder, of the angle given, which starts where the sphere
+ * of the occluder is nearest to the light. One with the light inside
+ * always does.
+ */
+static bool inCone(point light, vector axis, double near, double angle, point c, double receiverRadius)
+{
+    vector toReceiver = c - light;
+    double receiverDistance = sqrt(toReceiver * toReceiver);
+
+    if (receiverDistance <= receiverRadius)
+        return true;
+
+    /* The receiver is completely between the light and the object. */
+    if (receiverDistance + receiverRadius <= near)
+        return false;
+
+    /* The angle between both cones. */
+    double cosBetween = (toReceiver * axis) / receiverDistance;
+    cosBetween = cosBetween > 1 ? 1 : (cosBetween < -1 ? -1 : cosBetween);
+
+    return acos(cosBetween) <= angle + asin(receiverRadius / receiverDistance);
+}
+
+/* The search for an object, other than the occluder, in the cone of its
+ * shadow.
+ */
+class receiverQuery : public bvhQuery
+{
+private:
+    point light;
+    vector axis;
+    double near, angle;
+    int occluder;
+public:
+    receiverQuery(point light, vector axis, double near, double angle, int occluder):
+        light(light),
+        axis(axis),
+        near(near),
+        angle(angle),
+        occluder(occluder)
+    { }
+
+    bool enters(const float *lower, const float *upper)
+    {
+        point c;
+        double nodeRadius;
+
+        outerSphere(lower, upper, c, nodeRadius);
+        return inCone(light, axis, near, angle, c, nodeRadius);
+    }
+
+    bool visit(int object)
+    {
+        point lower, upper;
+
+        /* An object doesn't shadow itself. */
+        if (object == occluder || !objects[object]->getBounds(lower, upper))
+            return false;
+
+        return inCone(light, axis, near, angle, lower + 0.5 * (upper - lower),
+                sqrt((upper - lower) * (upper - lower)) / 2);
+    }
+};
+
+/* The search for a glass object crossing a plane. */
+class crossingQuery : public bvhQuery
+{
+private:
+    point p;
+    vector n;
+public:
+    crossingQuery(point p, vector n):
+        p(p),
+        n(n)
+    { }
+
+    bool enters(const float *lower, const float *upper)
+    {
+        point c;
+        double radius;
+
+        outerSphere(lower, upper, c, radius);
+        return fabs((c - p) * n) <= radius * sqrt(n * n);
+    }
+
+    bool visit(int object)
+    {
+        point lower, upper;
+
+        if (objects[object]->getRefraction() <= 0 || !objects[object]->getBounds(lower, upper))
+            return false;
+
+        point boxCentre = lower + 0.5 * (upper - lower);
+        double radius = sqrt((upper - lower) * (upper - lower)) / 2;
+
+        return fabs((boxCentre - p) * n) <= radius * sqrt(n * n);
+    }
+};
+
+/* The search for the objects whose shadow may reach a sphere: the ones
+ * inside the cone from the light around it, and nearer to the light than
+ * its far side. Each one found is marked, once.
+ */
+class casterQuery : public bvhQuery
+{
+private:
+    point light;
+    vector axis;
+    double angle, far;
+    bool *marked;
+    int *found;
+    int &noFound;
+public:
+    casterQuery(point light, point c, double radius, bool *marked, int *found, int &noFound):
+        light(light),
+        marked(marked),
+        found(found),
+        noFound(noFound)
+    {
+        axis = c - light;
+        double distance = sqrt(axis * axis);
+
+        axis /= distance;
+        angle = asin(radius / distance);
+        far = distance + radius;
+    }
+
+    /* Whether an object, by the sphere around it, may cast its shadow
+     * on the sphere. One with the light inside always does.
+     */
+    bool reaches(point c, double radius)
+    {
+        vector toCaster = c - light;
+        double distance = sqrt(toCaster * toCaster);
+
+        if (distance <= radius)
+            return true;
+        if (distance - radius >= far)
+            return false;
+
+        double cosBetween = (toCaster * axis) / distance;
+        cosBetween = cosBetween > 1 ? 1 : (cosBetween < -1 ? -1 : cosBetween);
+
+        return acos(cosBetween) <= angle + asin(radius / distance);
+    }
+
+    bool enters(const float *lower, const float *upper)
+    {
+        point c;
+        double radius;
+
+        outerSphere(lower, upper, c, radius);
+        return reaches(c, radius);
+    }
+
+    bool visit(int object)
+    {
+        point lower, upper;
+
+        if (!marked[object] && objects[object]->getBounds(lower, upper) &&
+                reaches(lower + 0.5 * (upper - lower), sqrt((upper - lower) * (upper - lower)) / 2))
+        {
+            marked[object] = true;
+            found[noFound++] = object;
+        }
+
+        return false;
+    }
+};
+
+/* Every object that can't be reached by a shadow ray is left out of the list.
+ * The eyes are the points from where the primary rays start, which will tell
+ * us which side of each plane can be seen.
+ */
+void Light::buildOccluders(point *eyes, int noEyes, sceneSearch search)
+{
+    int i;
+    point lower, upper;
+
+    freeOccluders();
+    occluders = new int[noObjects];
+    casts = new bool[noObjects];
+    occluderCentres = new point[noObjects];
+    occluderRadii = new double[noObjects];
+    unbounded = new int[noObjects];
+
+    for (i = 0; i < noObjects; i++)
+        if (!objects[i]->getBounds(lower, upper))
+            unbounded[noUnbounded++] = i;
+
+    for (i = 0; i < noObjects; i++)
+        casts[i] = mayOcclude(i, eyes, noEyes, search);
+
+    listOccluders();
+}
+
+/* After some objects moved, from the boxes they had before, only the ones
+ * whose shadow may have changed are tried again: the moved objects, the
+ * planes, which a glass object may have crossed, and the objects whose
+ * cone may reach where a moved one was or is now. The list is built again
+ * when the light was in the way of a move, or when most objects moved.
+ * Returns how many objects were tried.
+ */
+int Light::updateOccluders(const int *moved, int noMoved, const bvhBox *before,
+                           point *eyes, int noEyes, sceneSearch search)
+{
+    int i, k, noFound = 0;
+    point lower, upper;
+
+    if (occluders == NULL || 2 * noMoved > noObjects)
+    {
+        buildOccluders(eyes, noEyes, search);
+        return noObjects;
+    }
+
+    bool *marked = new bool[noObjects];
+    int *found = new int[noObjects];
+
+    for (i = 0; i < noObjects; i++)
+        marked[i] = false;
+    for (k = 0; k < noUnbounded; k++)
+    {
+        marked[unbounded[k]] = true;
+        found[noFound++] = unbounded[k];
+    }
+    for (k = 0; k < noMoved; k++)
+        if (!marked[moved[k]])
+        {
+            marked[moved[k]] = true;
+            found[noFound++] = moved[k];
+        }
+
+    for (k = 0; k < noMoved; k++)
+    {
+        bvhBox swept = before[k];
+        point c;
+        double radius;
+
+        if (!objects[moved[k]]->getBounds(lower, upper))
+            break;
+
+        swept.lower[0] = std::min(swept.lower[0], (float) lower.x);
+        swept.lower[1] = std::min(swept.lower[1], (float) lower.y);
+        swept.lower[2] = std::min(swept.lower[2], (float) lower.z);
+        swept.upper[0] = std::max(swept.upper[0], (float) upper.x);
+        swept.upper[1] = std::max(swept.upper[1], (float) upper.y);
+        swept.upper[2] = std::max(swept.upper[2], (float) upper.z);
+
+        outerSphere(swept.lower, swept.upper, c, radius);
+        vector toLight = centre - c;
+        if (toLight * toLight <= radius * radius)
+            break;
+
+        casterQuery query(centre, c, radius, marked, found, noFound);
+        search(query);
+    }
+
+    bool rebuild = k < noMoved;
+    if (!rebuild)
+        for (k = 0; k < noFound; k++)
+            casts[found[k]] = mayOcclude(found[k], eyes, noEyes, search);
+
+    delete [] marked;
+    delete [] found;
+
+    if (rebuild)
+    {
+        buildOccluders(eyes, noEyes, search);
+        return noObjects;
+    }
+
+    listOccluders();
+    return noFound;
+}
+
+/* Whether the object i may shadow something we see. */
+bool Light::mayOcclude(int i, point *eyes, int noEyes, sceneSearch search)
+{
+    int k;
+    point lower, upper, p;
+    vector n;
+
+    if (objects[i]->getBounds(lower, upper))
+        return castsShadow(i, lower, upper, search);
+
+    if (!objects[i]->getSupportingPlane(p, n))
+        return true;
+
+    /* An opaque plane with the light and all the eyes on the same side
+     * can't shadow anything we see, because no ray will ever get through
+     * it to the other side. The exception is a glass object crossing the
+     * plane, which would take the rays beyond it.
+     */
+    double lightSide = (centre - p) * n;
+    if (objects[i]->getRefraction() != 0 || fabs(lightSide) <= EPSLON)
+        return true;
+
+    for (k = 0; k < noEyes; k++)
+        if (((eyes[k] - p) * n) * lightSide <= EPSLON)
+            return true;
+
+    crossingQuery query(p, n);
+    return search(query);
+}
+
+/* Lists the occluders, in the order of the objects, and keeps the spheres
+ * around them, so the shadow rays can be culled against them without
+ * asking the objects again.
+ */
+void Light::listOccluders()
+{
+    int i;
+    point lower, upper;
+
+    noOccluders = 0;
+    for (i = 0; i < noObjects; i++)
+    {
+        if (!casts[i])
+            continue;
+
+        occluders[noOccluders] = i;
+        if (objects[i]->getBounds(lower, upper))
+        {
+            occluderCentres[noOccluders] = lower + 0.5 * (upper - lower);
+            occluderRadii[noOccluders] = sqrt((upper - lower) * (upper - lower)) / 2;
+        }
+        else
+            occluderRadii[noOccluders] = -1;
+        noOccluders++;
+    }
+}
+
+/* The shadow of a bounded object is kept inside a cone that starts at the light
+ * and wraps the sphere around the object. The object is only an occluder if
+ * some other object enters this cone behind it. The planes are tried first,
+ * as they are few and catch most cones, and then the search finds the other
+ * objects near the cone.
+ */
+bool Light::castsShadow(int index, point lower, point upper, sceneSearch search)
+{
+    int k;
+    point p;
+    vector n;
+
+    /* The sphere around the object. */
+    point objectCentre = lower + 0.5 * (upper - lower);
+    double radius = sqrt((upper - lower) * (upper - lower)) / 2;
+
+    vector axis = objectCentre - centre;
+    double distance = sqrt(axis * axis);
+
+    /* The light is inside the object, so there's no cone to talk about. */
+    if (distance <= radius)
+        return true;
+
+    axis /= distance;
+    double sinAngle = radius / distance;
+
+    for (k = 0; k < noUnbounded; k++)
+    {
+        if (objects[unbounded[k]]->getSupportingPlane(p, n))
+        {
+            /* The normal must point to the side of the light. Then, the cone
+             * only misses the plane if all its directions move away from it.
+             */
+            n /= sqrt(n * n);
+            double lightSide = (centre - p) * n;
+
+            if (fabs(lightSide) <= EPSLON)
+                return true;
+            if (lightSide < 0)
+                n = -1 * n;
+
+            if (axis * n < sinAngle)
+                return true;
+        }
+        else
+            return true;
+    }
+
+    receiverQuery query(centre, axis, distance - radius, asin(sinAngle), index);
+    return search(query);
+}
+
+int Light::getNoOccluders() { return noOccluders; }
+int Light::getOccluder(int i) { return occluders[i]; }
+const bool *Light::getCasts() { return casts; }
+int Light::getNoUnbounded() { return noUnbounded; }
+int Light::getUnbounded(int i) { return unbounded[i]; }
+
+/* Returns false if the occluder has no limits. */
+bool Light::getOccluderSphere(int i, point &c, double &radius)
+{
+    c = occluderCentres[i];
+    radius = occluderRadii[i];
+
+    return radius >= 0;
+}
+
+void Light::freeOccluders()
+{
+    delete [] occluders;
+    delete [] casts;
+    delete [] occluderCentres;
+    delete [] occluderRadii;
+    occluders = NULL;
+    casts = NULL;
+    occluderCentres = NULL;
+    occluderRadii = NULL;
+    noOccluders = 0;
+    delete [] unbounded;
+    unbounded = NULL;
+    noUnbounded = 0;
+}
+
+void Light::pack(Message &m)
+{
+    m.putPoint(centre);
+    m.putDouble(intensity);
+    m.putColour(c);
+}
+
+void Light::unpack(Message &m)
+{
+    centre = m.getPoint();
+    intensity = m.getDouble();
+    c = m.getColour();
+}
@@ -1 +1,92 @@
-#ifndef _H_Light#define _H_Light/* Defines the needed classes and their headers. */#include "BasicStructures.h"/* Header for the Sphere class. */class Light{private:	/* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/	/* The centre and the intensity of the light. */	point centre;		double intensity;	/* The colour of this sphere. */	colour c;public:	/* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/	/* Constructor & destructor. */	explicit Light(double x, double y, double z, double in, double rC, double gC, double bC);	explicit Light();	~Light();	/* - - - - - - - OTHER METHODS - - - - - - - -*/		/* - - - - - - - GETTERS & SETTERS - - - - - - - -*/	point getCentre();	double getIntensity();        double getFade(double distance);	double getR();	double getG();	double getB();};#endif
\ No newline at end of file
+#ifndef _H_Light
+#define _H_Light
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "BVH.h"
+
+/* Searches the boxes of the objects of the scene, with its tree if it has
+ * one. Returns true if a visit ended the search.
+ */
+typedef bool (*sceneSearch)(bvhQuery &query);
+
+/* Header for the Sphere class. */
+class Light
+{
+private:
+	/* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+	/* The centre and the intensity of the light. */
+	point centre;	
+	double intensity;
+	/* The colour of this sphere. */
+	colour c;
+	/* The indexes of the objects that may stand between this light and
+	 * something we can see. Only these are tested by the shadow rays.
+	 */
+	int noOccluders;
+	int *occluders;
+	/* Whether each object is an occluder, for the searches over the whole
+	 * scene.
+	 */
+	bool *casts;
+	/* The sphere around each occluder. Objects without limits get a
+	 * negative radius.
+	 */
+	point *occluderCentres;
+	double *occluderRadii;
+	/* The objects with no box, which every cone is tried against first. */
+	int noUnbounded;
+	int *unbounded;
+
+	/* Finds out if a bounded object can project its shadow on any other. */
+	bool castsShadow(int index, point lower, point upper, sceneSearch search);
+	bool mayOcclude(int i, point *eyes, int noEyes, sceneSearch search);
+	void listOccluders();
+	void copyOccluders(const Light &light);
+public:
+	/* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+	/* Constructor & destructor. */
+	explicit Light(double x, double y, double z, double in, double rC, double gC, double bC);
+	explicit Light();
+	~Light();
+	/* A copy of a light gets a list of occluders of its own. */
+	Light(const Light &light);
+	Light &operator = (const Light &light);
+
+	/* - - - - - - - OTHER METHODS - - - - - - - -*/
+	/* Builds the list of objects that may cast shadows from this light. The
+	 * objects another may shadow are found with the search.
+	 */
+	void buildOccluders(point *eyes, int noEyes, sceneSearch search);
+	/* Follows the objects moved since the list was built, given the box
+	 * each had before. Returns how many objects were tried again.
+	 */
+	int updateOccluders(const int *moved, int noMoved, const bvhBox *before,
+	                    point *eyes, int noEyes, sceneSearch search);
+	/* Frees the list of occluders. The destructor does too, but the lights
+	 * of a scene are kept in its arena, which runs no destructors.
+	 */
+	void freeOccluders();
+	/* Writes the light into a message, and reads it back from one. The
+	 * occluders are built again where it is read.
+	 */
+	void pack(Message &m);
+	void unpack(Message &m);
+
+	/* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+	point getCentre();
+	double getIntensity();
+        double getFade(double distance);
+	double getR();
+	double getG();
+	double getB();
+	int getNoOccluders();
+	int getOccluder(int i);
+	bool getOccluderSphere(int i, point &c, double &radius);
+	const bool *getCasts();
+	int getNoUnbounded();
+	int getUnbounded(int i);
+
+};
+
+#endif
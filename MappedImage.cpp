@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "MappedImage.h"
+
+/* In the constructor, we find the format from the extension of the file. */
+MappedImage::MappedImage(const char *fileName, int width, int height, long long noPixels):
+    width(width),
+    height(height),
+    data(NULL),
+    noPixels(noPixels),
+    pixelsWritten(0)
+{
+    const char *extension = strrchr(fileName, '.');
+    char header[32];
+
+    if (extension != NULL && (strcmp(extension, ".ppm") == 0 || strcmp(extension, ".PPM") == 0))
+    {
+        format = IMAGE_PPM;
+        headerSize = sprintf(header, "P6\n%d %d\n255\n", width, height);
+    }
+    else
+    {
+        format = IMAGE_TGA;
+        headerSize = 18;
+    }
+
+    this->fileName = new char[strlen(fileName) + 1];
+    strcpy(this->fileName, fileName);
+
+    size = headerSize + (long long) width * height * 3;
+}
+
+/* Destructor. */
+MappedImage::~MappedImage()
+{
+    close();
+    delete [] fileName;
+}
+
+bool MappedImage::open()
+{
+#ifdef _WIN32
+    file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD) (size >> 32), (DWORD) size, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    data = (unsigned char *) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (data == NULL)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+#else
+    file = ::open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+        return false;
+
+    if (ftruncate(file, size) != 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    void *view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(file);
+        return false;
+    }
+    data = (unsigned char *) view;
+#endif
+
+    if (format == IMAGE_TGA)
+    {
+        /* No identification nor palette, uncompressed true colour, 24 bits
+         * per pixel, starting at the bottom left.
+         */
+        memset(data, 0, 18);
+        data[2] = 2;
+        data[12] = width & 0xff;
+        data[13] = width >> 8;
+        data[14] = height & 0xff;
+        data[15] = height >> 8;
+        data[16] = 24;
+    }
+    else
+    {
+        /* sprintf() ends the text with a zero, which must not fall on the
+         * first pixel.
+         */
+        char header[32];
+        sprintf(header, "P6\n%d %d\n255\n", width, height);
+        memcpy(data, header, headerSize);
+    }
+
+    return true;
+}
+
+void MappedImage::close()
+{
+    if (data == NULL)
+        return;
+
+#ifdef _WIN32
+    FlushViewOfFile(data, 0);
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    msync(data, size, MS_SYNC);
+    munmap(data, size);
+    ::close(file);
+#endif
+
+    data = NULL;
+}
+
+/* TGA files keep their rows from the bottom, as our image; PPM files from
+ * the top.
+ */
+unsigned char *MappedImage::getPixel(int x, int y)
+{
+    int row = format == IMAGE_TGA ? y : height - 1 - y;
+
+    return data + headerSize + ((long long) row * width + x) * 3;
+}
+
+void MappedImage::written(int count)
+{
+    if (__sync_add_and_fetch(&pixelsWritten, (long long) count) == noPixels)
+    {
+        close();
+        printf("Image written to %s.\n", fileName);
+    }
+}
+
+bool MappedImage::isBGR() { return format == IMAGE_TGA; }
@@ -0,0 +1,61 @@
+#ifndef _H_MappedImage
+#define _H_MappedImage
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "ImageWriter.h"
+
+/* Header for the MappedImage class. It is an uncompressed TGA or PPM file,
+ * made with its final size and mapped into memory, so the threads write
+ * their tiles straight into it. The image is then never kept anywhere
+ * else, whatever its size.
+ */
+class MappedImage
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* IMAGE_TGA or IMAGE_PPM, found from the name of the file. */
+    int format;
+    char *fileName;
+    int width, height;
+    /* The whole file, and where its pixels start. */
+    unsigned char *data;
+    long long size;
+    int headerSize;
+    /* How many pixels are to be written and how many already are. The file
+     * is closed by the thread that writes the last ones.
+     */
+    long long noPixels;
+    volatile long long pixelsWritten;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int file;
+#endif
+
+    void close();
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. Only noPixels of the image are traced, the
+     * others stay black.
+     */
+    explicit MappedImage(const char *fileName, int width, int height, long long noPixels);
+    ~MappedImage();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Makes the file and maps it. Returns false on failure. */
+    bool open();
+    /* Gives where the pixel (x, y) is in the file. The pixels to its right
+     * follow it.
+     */
+    unsigned char *getPixel(int x, int y);
+    /* Tells that count more pixels are written. */
+    void written(int count);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    /* If the colours are kept as BGR instead of RGB. */
+    bool isBGR();
+};
+
+#endif
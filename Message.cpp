@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+
+/* Defines the needed classes and their headers. */
+#include "Message.h"
+
+/* The largest message accepted, so a broken connection can't make us
+ * reserve any amount of memory.
+ */
+#define MESSAGE_LIMIT (1 << 30)
+
+/* Constructor. */
+Message::Message():
+    data(NULL),
+    size(0),
+    capacity(0),
+    position(0),
+    valid(true)
+{ }
+
+/* Destructor. */
+Message::~Message()
+{
+    delete [] data;
+}
+
+/* Makes room for more bytes, doubling the room each time. */
+void Message::reserve(int more)
+{
+    if (size + more <= capacity)
+        return;
+
+    int c = capacity > 0 ? capacity : 256;
+    while (c < size + more)
+        c *= 2;
+
+    unsigned char *bigger = new unsigned char[c];
+    if (size > 0)
+        memcpy(bigger, data, size);
+    delete [] data;
+
+    data = bigger;
+    capacity = c;
+}
+
+void Message::clear()
+{
+    size = 0;
+    position = 0;
+    valid = true;
+}
+
+void Message::putInt(int v)
+{
+    reserve(4);
+    data[size++] = v;
+    data[size++] = v >> 8;
+    data[size++] = v >> 16;
+    data[size++] = v >> 24;
+}
+
+void Message::putLong(long long v)
+{
+    putInt((int) v);
+    putInt((int) (v >> 32));
+}
+
+/* A double goes as the 8 bytes of its number. */
+void Message::putDouble(double v)
+{
+    long long bits;
+
+    memcpy(&bits, &v, 8);
+    putLong(bits);
+}
+
+void Message::putPoint(point p)
+{
+    putDouble(p.x);
+    putDouble(p.y);
+    putDouble(p.z);
+}
+
+void Message::putVector(vector v)
+{
+    putDouble(v.x);
+    putDouble(v.y);
+    putDouble(v.z);
+}
+
+void Message::putColour(colour c)
+{
+    putDouble(c.r);
+    putDouble(c.g);
+    putDouble(c.b);
+}
+
+void Message::putBytes(const void *bytes, int count)
+{
+    reserve(count);
+    memcpy(&data[size], bytes, count);
+    size += count;
+}
+
+int Message::getInt()
+{
+    if (position + 4 > size)
+    {
+        valid = false;
+        return 0;
+    }
+
+    unsigned char *in = &data[position];
+    position += 4;
+
+    return in[0] | in[1] << 8 | in[2] << 16 | in[3] << 24;
+}
+
+long long Message::getLong()
+{
+    unsigned int low = getInt();
+    long long high = getInt();
+
+    return high << 32 | low;
+}
+
+double Message::getDouble()
+{
+    long long bits = getLong();
+    double v;
+
+    memcpy(&v, &bits, 8);
+    return v;
+}
+
+point Message::getPoint()
+{
+    point p;
+    p.x = getDouble();
+    p.y = getDouble();
+    p.z = getDouble();
+    return p;
+}
+
+vector Message::getVector()
+{
+    vector v;
+    v.x = getDouble();
+    v.y = getDouble();
+    v.z = getDouble();
+    return v;
+}
+
+colour Message::getColour()
+{
+    colour c;
+    c.r = getDouble();
+    c.g = getDouble();
+    c.b = getDouble();
+    return c;
+}
+
+void Message::getBytes(void *bytes, int count)
+{
+    if (count < 0 || position + count > size)
+    {
+        valid = false;
+        memset(bytes, 0, count > 0 ? count : 0);
+        return;
+    }
+
+    memcpy(bytes, &data[position], count);
+    position += count;
+}
+
+/* The FNV-1a hash of 64 bits. */
+unsigned long long Message::hashRest()
+{
+    unsigned long long h = 14695981039346656037ULL;
+    int i;
+
+    for (i = position; i < size; i++)
+    {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/* Each message starts with its type and its size. */
+bool Message::send(Socket *socket, int type)
+{
+    unsigned char header[8];
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        header[i] = type >> (8 * i);
+        header[4 + i] = size >> (8 * i);
+    }
+
+    return socket->send(header, 8) && (size == 0 || socket->send(data, size));
+}
+
+bool Message::receive(Socket *socket, int &type)
+{
+    unsigned char header[8];
+
+    clear();
+
+    if (!socket->receive(header, 8))
+        return false;
+
+    type = header[0] | header[1] << 8 | header[2] << 16 | header[3] << 24;
+    int length = header[4] | header[5] << 8 | header[6] << 16 | header[7] << 24;
+
+    if (length < 0 || length > MESSAGE_LIMIT)
+        return false;
+
+    reserve(length);
+    size = length;
+
+    return size == 0 || socket->receive(data, size);
+}
+
+bool Message::save(const char *fileName)
+{
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL)
+        return false;
+
+    bool written = (int) fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && written;
+}
+
+bool Message::load(const char *fileName)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (file == NULL)
+        return false;
+
+    clear();
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (length < 0 || length > MESSAGE_LIMIT)
+    {
+        fclose(file);
+        return false;
+    }
+
+    reserve(length);
+    size = fread(data, 1, length, file);
+    fclose(file);
+
+    return size == length;
+}
+
+unsigned char *Message::getData() { return data; }
+int Message::getSize() { return size; }
+bool Message::isValid() { return valid; }
@@ -0,0 +1,87 @@
+#ifndef _H_Message
+#define _H_Message
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Socket.h"
+
+/* The messages between the master and its workers. The master sends the
+ * job, which is the settings of the render and the scene, then the tiles
+ * each worker asks for, or that the image is done. The workers send back
+ * the pixels of each tile they trace.
+ */
+#define MESSAGE_JOB 1
+#define MESSAGE_ASK 2
+#define MESSAGE_TILES 3
+#define MESSAGE_PIXELS 4
+#define MESSAGE_DONE 5
+
+/* A client asks a render server for an image, which it gets back whole or
+ * tile by tile, as the tiles are done.
+ */
+#define MESSAGE_RENDER 6
+#define MESSAGE_IMAGE 7
+
+/* Header for the Message class. It holds the numbers sent at once to
+ * another process, which may run on another machine. They are kept in the
+ * same way on every machine: the lowest byte first.
+ */
+class Message
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    unsigned char *data;
+    int size, capacity;
+    /* Where the next number is read, and if any was missing. */
+    int position;
+    bool valid;
+
+    void reserve(int more);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Message();
+    ~Message();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    void clear();
+
+    void putInt(int v);
+    void putLong(long long v);
+    void putDouble(double v);
+    void putPoint(point p);
+    void putVector(vector v);
+    void putColour(colour c);
+    void putBytes(const void *bytes, int count);
+
+    /* Reading past the end gives zeros, and makes the message invalid. */
+    int getInt();
+    long long getLong();
+    double getDouble();
+    point getPoint();
+    vector getVector();
+    colour getColour();
+    void getBytes(void *bytes, int count);
+
+    /* A number made from all the bytes not read yet, which tells apart two
+     * messages that differ in any of them.
+     */
+    unsigned long long hashRest();
+
+    /* Sends the message with its type, or waits for the next one. Both
+     * return false if the connection is lost.
+     */
+    bool send(Socket *socket, int type);
+    bool receive(Socket *socket, int &type);
+
+    /* Keeps the message in a file, and reads it back. */
+    bool save(const char *fileName);
+    bool load(const char *fileName);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    unsigned char *getData();
+    int getSize();
+    bool isValid();
+};
+
+#endif
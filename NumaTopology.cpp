@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "NumaTopology.h"
+
+/* In the constructor, we ask the system for the processors and nodes. */
+NumaTopology::NumaTopology():
+    noNodes(1)
+{
+    int i;
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    noProcessors = info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    noProcessors = n > 0 ? n : 1;
+#endif
+
+    nodeOf = new int[noProcessors];
+    for (i = 0; i < noProcessors; i++)
+        nodeOf[i] = 0;
+
+    findNodes();
+}
+
+/* Destructor. */
+NumaTopology::~NumaTopology()
+{
+    delete [] nodeOf;
+}
+
+#ifdef _WIN32
+void NumaTopology::findNodes()
+{
+    ULONG highest;
+    ULONGLONG mask;
+    int node, i, found = 0;
+
+    if (!GetNumaHighestNodeNumber(&highest) || highest == 0)
+        return;
+
+    for (node = 0; node <= (int) highest && node < MAX_NODES; node++)
+    {
+        if (!GetNumaNodeProcessorMask(node, &mask) || mask == 0)
+            continue;
+
+        for (i = 0; i < noProcessors && i < 64; i++)
+            if (mask & ((ULONGLONG) 1 << i))
+                nodeOf[i] = found;
+        found++;
+    }
+
+    noNodes = found > 0 ? found : 1;
+}
+#else
+/* Each node lists its processors, as in "0-7,16-23". */
+void NumaTopology::findNodes()
+{
+    char fileName[64], list[4096];
+    int node, found = 0;
+
+    for (node = 0; node < MAX_NODES; node++)
+    {
+        sprintf(fileName, "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *file = fopen(fileName, "r");
+        if (file == NULL)
+            continue;
+
+        bool read = fgets(list, sizeof(list), file) != NULL;
+        fclose(file);
+        if (!read)
+            continue;
+
+        char *p = list;
+        bool any = false;
+        while (*p >= '0' && *p <= '9')
+        {
+            int first = strtol(p, &p, 10), last = first;
+            if (*p == '-')
+                last = strtol(p + 1, &p, 10);
+
+            for (; first <= last; first++)
+                if (first < noProcessors)
+                {
+                    nodeOf[first] = found;
+                    any = true;
+                }
+
+            if (*p == ',')
+                p++;
+        }
+
+        if (any)
+            found++;
+    }
+
+    noNodes = found > 0 ? found : 1;
+}
+#endif
+
+int NumaTopology::placeThread(int thread)
+{
+    int node = thread % noNodes;
+    int k = thread / noNodes;
+    int i, count = 0;
+
+    /* How many processors the node has, so more threads than that go
+     * round them again.
+     */
+    for (i = 0; i < noProcessors; i++)
+        if (nodeOf[i] == node)
+            count++;
+    if (count == 0)
+        return thread % noProcessors;
+
+    k %= count;
+    for (i = 0; i < noProcessors; i++)
+        if (nodeOf[i] == node && k-- == 0)
+            return i;
+
+    return thread % noProcessors;
+}
+
+int NumaTopology::getNoProcessors() { return noProcessors; }
+int NumaTopology::getNoNodes() { return noNodes; }
+int NumaTopology::getNode(int processor) { return nodeOf[processor]; }
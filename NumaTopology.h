@@ -0,0 +1,39 @@
+#ifndef _H_NumaTopology
+#define _H_NumaTopology
+
+/* The most nodes we tell apart. */
+#define MAX_NODES 64
+
+/* Header for the NumaTopology class. It tells the processors of this
+ * machine and the node each belongs to: the processors of a node share a
+ * memory, which they reach faster than the memory of the other nodes. On a
+ * machine with a single memory, every processor is on node 0.
+ */
+class NumaTopology
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int noProcessors, noNodes;
+    /* For each processor, its node. */
+    int *nodeOf;
+
+    void findNodes();
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit NumaTopology();
+    ~NumaTopology();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* The processor the thread i should run on. The threads go to each node
+     * in turn, so they are spread evenly among them.
+     */
+    int placeThread(int thread);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getNoProcessors();
+    int getNoNodes();
+    int getNode(int processor);
+};
+
+#endif
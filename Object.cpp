@@ -1,12 +1,48 @@
 /* Defines the needed classes and their headers. */
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
 
 /* Constructor. */
-Object::Object() { }
+Object::Object(): maxDepth(-1) { }
 /* Destructor */
 Object::~Object() {}
 
+/* By default, an object has no known limits nor a supporting plane. Each
+ * object must override the one that applies to it.
+ */
+bool Object::getBounds(point &, point &) { return false; }
+bool Object::getSupportingPlane(point &, vector &) { return false; }
+
+/* Most objects have the same colour all over them. */
+colour Object::getDiffuse(point) { return diffuse; }
+
+/* Most objects are placed by their centre alone. */
+void Object::move(vector offset) { centre = centre + offset; }
+
+/* What all the objects have. Each kind of object adds its own. */
+void Object::pack(Message &m)
+{
+    m.putPoint(centre);
+    m.putColour(diffuse);
+    m.putDouble(reflection);
+    m.putDouble(refraction);
+    m.putDouble(shininess);
+    m.putColour(specular);
+    m.putInt(maxDepth);
+}
+
+void Object::unpack(Message &m)
+{
+    centre = m.getPoint();
+    diffuse = m.getColour();
+    reflection = m.getDouble();
+    refraction = m.getDouble();
+    shininess = m.getDouble();
+    specular = m.getColour();
+    maxDepth = m.getInt();
+}
+
 point Object::getCentre() { return centre; }
 
 /* Returns the colour of this Object. */
@@ -18,8 +54,10 @@ double Object::getReflection() {return reflection;}
 double Object::getRefraction() {return refraction;}
 double Object::getShininess() { return shininess;}
 colour Object::getSpecular() { return specular;}
+int Object::getMaxDepth() { return maxDepth;}
 void Object::setReflection(double v) {reflection = v;}
 void Object::setRefraction(double v) {refraction = v;}
 void Object::setShininess(double v) {shininess = v;}
 void Object::setSpecular(double rC, double gC, double bC) {specular.r = rC; specular.g = gC; specular.b = bC;}
+void Object::setMaxDepth(int v) {maxDepth = v;}
 
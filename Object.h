@@ -1 +1,83 @@
-#ifndef _H_Object#define _H_Object/* Defines the needed classes and their headers. */class Ray;#include "BasicStructures.h"/* Header for the Sphere class. */class Object{protected:    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/    /* The the centre and the colour of the object. */    point centre;    /* The diffuse component. */    colour diffuse;    /* Coeficients used for the Lambert and Blinn-Phong Effects. */    double reflection, refraction, shininess;    colour specular;public:    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/    /* Constructor & destructor. */    explicit Object();    ~Object();    /* - - - - - - - OTHER METHODS - - - - - - - -*/    /* Method to find the intersection point of a ray with this object. */    virtual bool intersects(Ray &ray, double &rT0, double &rT1) = 0;    /* Given an intersection point, calculates the new direction of the ray. */    virtual void newDirection(Ray &ray, double &t) = 0;    /* Given an intersection point, calculates the new starting point of the     * ray after the refraction.     */    virtual bool refractionRedirection(Ray &ray, double t0, double t1) = 0;    /* Calculates the normal vector at the intersection point. */    virtual void intersectionPointNormal(Ray &ray, vector &normalInt) = 0;    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/    point getCentre();    double getR();    double getG();    double getB();    double getReflection();    double getRefraction();    double getShininess();    colour getSpecular();    void setReflection(double v);    void setRefraction(double v);    void setShininess(double v);    void setSpecular(double rC, double gC, double bC);        };#endif
\ No newline at end of file
+#ifndef _H_Object
+#define _H_Object
+
+/* Defines the needed classes and their headers. */
+class Ray;
+#include "BasicStructures.h"
+
+/* Header for the Sphere class. */
+class Object{
+protected:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* The the centre and the colour of the object. */
+    point centre;
+    /* The diffuse component. */
+    colour diffuse;
+    /* Coeficients used for the Lambert and Blinn-Phong Effects. */
+    double reflection, refraction, shininess;
+    colour specular;
+    /* The most bounces after hitting this object, or -1 to use the depth
+     * of the whole render.
+     */
+    int maxDepth;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Object();
+    virtual ~Object();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Method to find the intersection point of a ray with this object. */
+    virtual bool intersects(Ray &ray, double &rT0, double &rT1) = 0;
+    /* Given an intersection point, calculates the new direction of the ray. */
+    virtual void newDirection(Ray &ray, double &t) = 0;
+    /* Given an intersection point, calculates the new starting point of the
+     * ray after the refraction.
+     */
+    virtual bool refractionRedirection(Ray &ray, double t0, double t1) = 0;
+    /* Calculates the normal vector at the intersection point. */
+    virtual void intersectionPointNormal(Ray &ray, vector &normalInt) = 0;
+    /* Gives the box that encloses the whole object. Objects without limits,
+     * such as planes, return false.
+     */
+    virtual bool getBounds(point &lower, point &upper);
+    /* Gives a point and the normal of the plane that holds an object without
+     * limits. Any other object returns false.
+     */
+    virtual bool getSupportingPlane(point &p, vector &n);
+    /* Gives the diffuse colour at a given point of the object. */
+    virtual colour getDiffuse(point p);
+    /* Moves the whole object by the offset, as it is animated. */
+    virtual void move(vector offset);
+
+    /* Tells which kind of object this is, one of the OBJECT_ kinds. */
+    virtual int getType() = 0;
+    /* Writes the object into a message, and reads it back from one, so it
+     * can be sent to another process.
+     */
+    virtual void pack(Message &m);
+    virtual void unpack(Message &m);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    point getCentre();
+
+    double getR();
+    double getG();
+    double getB();
+
+    double getReflection();
+    double getRefraction();
+    double getShininess();
+    colour getSpecular();
+    int getMaxDepth();
+
+    void setReflection(double v);
+    void setRefraction(double v);
+    void setShininess(double v);
+    void setSpecular(double rC, double gC, double bC);
+    void setMaxDepth(int v);
+        
+};
+
+#endif
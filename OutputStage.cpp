@@ -0,0 +1,196 @@
+#include <cmath>
+#include <stdlib.h>
+#include <string.h>
+
+/* With GCC on x86, the AVX2 code is built whatever the flags, and only run
+ * if the processor has it.
+ */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define OUTPUT_AVX2
+#include <immintrin.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "OutputStage.h"
+#include "HugePages.h"
+
+extern colour image[SCREEN_W][SCREEN_H];
+
+/* In the constructor, we build the gamma table. The output is only made
+ * when something is resolved into it.
+ */
+OutputStage::OutputStage(int width, int height, int filter, double exposure, bool tonemap, double gamma):
+    width(width),
+    height(height),
+    filter(filter),
+    exposure(exposure),
+    tonemap(tonemap),
+    avx2(false),
+    pixels(NULL)
+{
+    int i;
+
+#ifdef OUTPUT_AVX2
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    for (i = 0; i < GAMMA_TABLE_SIZE; i++)
+        gammaTable[i] = (int) (255.0 * pow((double) i / (GAMMA_TABLE_SIZE - 1), 1.0 / gamma) + 0.5);
+}
+
+/* Destructor. */
+OutputStage::~OutputStage()
+{
+    HugePages::release(pixels, width*height*3);
+}
+
+/* The box filter takes the pixel as it is. The tent filter also takes its
+ * eight neighbours, with weights 1, 2, 1 on each axis.
+ */
+colour OutputStage::filtered(int x, int y)
+{
+    int i, j;
+    colour sum;
+    double weights = 0;
+
+    if (filter != FILTER_TENT)
+        return image[x][y];
+
+    sum.r = sum.g = sum.b = 0;
+
+    for (i = -1; i <= 1; i++)
+        for (j = -1; j <= 1; j++)
+        {
+            if (x + j < 0 || y + i < 0 || x + j >= width || y + i >= height)
+                continue;
+
+            double weight = (2 - abs(i)) * (2 - abs(j));
+            colour c = image[x + j][y + i];
+
+            sum.r += weight * c.r;
+            sum.g += weight * c.g;
+            sum.b += weight * c.b;
+            weights += weight;
+        }
+
+    sum.r /= weights;
+    sum.g /= weights;
+    sum.b /= weights;
+
+    return sum;
+}
+
+#ifdef OUTPUT_AVX2
+/* The same as the scalar code of quantiseChannel(), eight values at once.
+ * The maximum gives its second operand when the first is not a number, so
+ * those become 0 too.
+ */
+__attribute__((target("avx2")))
+static void quantiseAVX2(float *in, float exposure, bool tonemap, const int *gammaTable, int *values)
+{
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(in), _mm256_set1_ps(exposure));
+
+    if (tonemap)
+        v = _mm256_div_ps(v, _mm256_add_ps(v, _mm256_set1_ps(1.0f)));
+
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    v = _mm256_mul_ps(v, _mm256_set1_ps(GAMMA_TABLE_SIZE - 1));
+
+    /* Rounded as the scalar code does, half up, not to the nearest even. */
+    __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+    _mm256_storeu_si256((__m256i *) values, _mm256_i32gather_epi32(gammaTable, index, 4));
+}
+#endif
+
+/* The exposure scales the colour. The tone mapping then brings any value
+ * into [0, 1), as c / (1 + c); without it, values above 1 are clipped, and
+ * a value that is not a number, as an infinite one tone mapped, becomes 0.
+ * The gamma table gives the final value.
+ */
+void OutputStage::quantiseChannel(float *in, unsigned char *out, int stride)
+{
+    int i;
+    int values[8];
+
+#ifdef OUTPUT_AVX2
+    if (avx2)
+        quantiseAVX2(in, (float) exposure, tonemap, gammaTable, values);
+    else
+#endif
+    for (i = 0; i < 8; i++)
+    {
+        float v = in[i] * (float) exposure;
+
+        if (tonemap)
+            v = v / (v + 1.0f);
+
+        v = v > 0 ? (v < 1 ? v : 1) : 0;
+        values[i] = gammaTable[(int) (v * (GAMMA_TABLE_SIZE - 1) + 0.5f)];
+    }
+
+    for (i = 0; i < 8; i++)
+        out[i * stride] = (unsigned char) values[i];
+}
+
+void OutputStage::quantise(colour *in, int count, unsigned char *out, bool bgr)
+{
+    int j, k;
+    float r[8], g[8], b[8];
+    unsigned char rgb[8 * 3];
+
+    for (j = 0; j < count; j += 8)
+    {
+        int n = count - j < 8 ? count - j : 8;
+
+        /* The eight pixels are gathered by channel, so each step works on
+         * all of them. The last ones may be fewer.
+         */
+        for (k = 0; k < 8; k++)
+        {
+            colour c = in[j + (k < n ? k : n - 1)];
+            r[k] = (float) c.r;
+            g[k] = (float) c.g;
+            b[k] = (float) c.b;
+        }
+
+        quantiseChannel(r, rgb + (bgr ? 2 : 0), 3);
+        quantiseChannel(g, rgb + 1, 3);
+        quantiseChannel(b, rgb + (bgr ? 0 : 2), 3);
+
+        memcpy(&out[j*3], rgb, n * 3);
+    }
+}
+
+void OutputStage::resolve(int x, int y, int w, int h)
+{
+    int i, j;
+    colour row[TILE_SIZE + 2];
+
+    getPixels();
+
+    for (i = y; i < y + h; i++)
+        for (j = x; j < x + w; j += TILE_SIZE + 2)
+        {
+            int count = x + w - j < TILE_SIZE + 2 ? x + w - j : TILE_SIZE + 2;
+            int k;
+
+            for (k = 0; k < count; k++)
+                row[k] = filtered(j + k, i);
+
+            quantise(row, count, &pixels[(i*width + j)*3], false);
+        }
+}
+
+int OutputStage::getWidth() { return width; }
+int OutputStage::getHeight() { return height; }
+int OutputStage::getFilter() { return filter; }
+
+/* The output is only made when it is first needed. */
+unsigned char *OutputStage::getPixels()
+{
+    if (pixels == NULL)
+        pixels = (unsigned char *) HugePages::allocate(width*height*3);
+
+    return pixels;
+}
@@ -0,0 +1,58 @@
+#ifndef _H_OutputStage
+#define _H_OutputStage
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+
+/* The number of entries of the gamma table. */
+#define GAMMA_TABLE_SIZE 4096
+
+/* Header for the OutputStage class. It turns the colours of the image into
+ * the 8 bit pixels shown in the window and written to files: filtering,
+ * exposure, tone mapping, gamma and quantisation, a rectangle at a time.
+ * When the processor has AVX2, eight pixels go through each step together.
+ */
+class OutputStage
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int width, height;
+    /* FILTER_BOX or FILTER_TENT. */
+    int filter;
+    double exposure;
+    bool tonemap;
+    /* The 8 bit value of each colour in [0, 1], with the gamma applied. */
+    int gammaTable[GAMMA_TABLE_SIZE];
+    /* Whether the processor has AVX2. */
+    bool avx2;
+    /* The output, one row after the other from the bottom, in RGB. It is
+     * only made when first asked for.
+     */
+    unsigned char *pixels;
+
+    /* Gives the filtered colour of the pixel (x, y) of the image. */
+    colour filtered(int x, int y);
+    /* Turns eight values of a channel into 8 bit values. */
+    void quantiseChannel(float *in, unsigned char *out, int stride);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit OutputStage(int width, int height, int filter, double exposure, bool tonemap, double gamma);
+    ~OutputStage();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Updates the output of the rectangle that starts at (x, y). */
+    void resolve(int x, int y, int w, int h);
+    /* Turns count colours, already filtered, into 8 bit pixels written to
+     * out, as RGB or as BGR.
+     */
+    void quantise(colour *in, int count, unsigned char *out, bool bgr);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getWidth();
+    int getHeight();
+    int getFilter();
+    unsigned char *getPixels();
+};
+
+#endif
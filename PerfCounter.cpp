@@ -0,0 +1,78 @@
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "PerfCounter.h"
+
+#ifdef _WIN32
+/* Windows doesn't let a program read these counters by itself. */
+PerfCounter::PerfCounter():
+    handle(-1)
+{ }
+
+PerfCounter::~PerfCounter() { }
+
+long long PerfCounter::read() { return -1; }
+
+double PerfCounter::now()
+{
+    LARGE_INTEGER count, frequency;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double) count.QuadPart / frequency.QuadPart;
+}
+#else
+/* In the constructor, the counter starts, only for the calling thread and
+ * only while it runs our code.
+ */
+PerfCounter::PerfCounter()
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    handle = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Destructor. */
+PerfCounter::~PerfCounter()
+{
+    if (handle >= 0)
+        close(handle);
+}
+
+long long PerfCounter::read()
+{
+    long long count;
+
+    if (handle < 0 || ::read(handle, &count, sizeof(count)) != sizeof(count))
+        return -1;
+
+    return count;
+}
+
+double PerfCounter::now()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+#endif
+
+bool PerfCounter::isCounting() { return handle >= 0; }
@@ -0,0 +1,35 @@
+#ifndef _H_PerfCounter
+#define _H_PerfCounter
+
+/* Header for the PerfCounter class. It counts, for the thread that makes
+ * it, how many times a load missed the data TLB, the cache of the places of
+ * the pages, while the counter is alive. Not every system lets us count
+ * them: then, the counter tells so.
+ */
+class PerfCounter
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* The counter of the system, or -1. */
+    int handle;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit PerfCounter();
+    ~PerfCounter();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* The misses since the counter was made, or -1 if they aren't counted. */
+    long long read();
+
+    /* The time in seconds, from a moment that only matters to tell how long
+     * something took.
+     */
+    static double now();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    bool isCounting();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "Plane.h"
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
 
 /* In the constructor, we set the starting point of the ray. */
 Plane::Plane(double x, double y, double z, vector n, double rC, double gC, double bC):
@@ -87,5 +88,28 @@ void Plane::intersectionPointNormal(Ray &ray, vector &normalInt)
     return;
 }
 
+/* A plane has no limits, but we know exactly where it stands. */
+bool Plane::getSupportingPlane(point &p, vector &n)
+{
+    p = centre;
+    n = normal;
+
+    return true;
+}
+
+int Plane::getType() { return OBJECT_PLANE; }
+
+void Plane::pack(Message &m)
+{
+    Object::pack(m);
+    m.putVector(normal);
+}
+
+void Plane::unpack(Message &m)
+{
+    Object::unpack(m);
+    normal = m.getVector();
+}
+
 /* Returns the radius of the sphere. */
 vector Plane::getNormal() { return normal; }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "PlaneChess.h"
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
 #include <iostream>
 
 /* In the constructor, we set the starting point of the ray. */
@@ -46,13 +47,20 @@ bool PlaneChess::intersects(Ray &ray, double &rT0, double &rT1)
         if (rT0 > ray.getToLightDistance())
             return false;
 
-    /* As this is a chess plane, we have to first check which colour
-     * should be this one.
-     */
-    point iP = ray.getOrigin() + rT0*ray.getDir();
+    return true;
+}
+
+/* As this is a chess plane, we have to first check which colour
+ * should be this one. This is done at the point that was hit, instead of
+ * keeping the colour of the last intersection, which may belong to
+ * another ray.
+ */
+colour PlaneChess::getDiffuse(point p)
+{
+    colour c;
 
-    int xTemp = int(floor(iP.x / squareSize));
-    int zTemp = int (floor(iP.z / squareSize));
+    int xTemp = int(floor(p.x / squareSize));
+    int zTemp = int (floor(p.z / squareSize));
 
    //std::cout << "We have " << xTemp << " and " << zTemp << std::endl;
     /* Now, depending on the position it hits, draw a white or black square. */
@@ -60,34 +68,34 @@ bool PlaneChess::intersects(Ray &ray, double &rT0, double &rT1)
     {
         if ((zTemp & 1) == 0)
         {
-            diffuse.r = 1;
-            diffuse.g = 1;
-            diffuse.b = 1;
+            c.r = 1;
+            c.g = 1;
+            c.b = 1;
         }
         else
         {
-            diffuse.r = 0;
-            diffuse.g = 0;
-            diffuse.b = 0;
+            c.r = 0;
+            c.g = 0;
+            c.b = 0;
         }
     }
     else
     {
       if ((zTemp & 1) == 0)
         {
-            diffuse.r = 0;
-            diffuse.g = 0;
-            diffuse.b = 0;
+            c.r = 0;
+            c.g = 0;
+            c.b = 0;
         }
         else
         {
-            diffuse.r = 1;
-            diffuse.g = 1;
-            diffuse.b = 1;
+            c.r = 1;
+            c.g = 1;
+            c.b = 1;
         }
     }
-    
-    return true;
+
+    return c;
 }
 
 void PlaneChess::newDirection(Ray &ray, double &t)
@@ -128,5 +136,30 @@ void PlaneChess::intersectionPointNormal(Ray &ray, vector &normalInt)
     return;
 }
 
+/* A plane has no limits, but we know exactly where it stands. */
+bool PlaneChess::getSupportingPlane(point &p, vector &n)
+{
+    p = centre;
+    n = normal;
+
+    return true;
+}
+
+int PlaneChess::getType() { return OBJECT_PLANE_CHESS; }
+
+void PlaneChess::pack(Message &m)
+{
+    Object::pack(m);
+    m.putVector(normal);
+    m.putDouble(squareSize);
+}
+
+void PlaneChess::unpack(Message &m)
+{
+    Object::unpack(m);
+    normal = m.getVector();
+    squareSize = m.getDouble();
+}
+
 /* Returns the radius of the sphere. */
 vector PlaneChess::getNormal() { return normal; }
\ No newline at end of file
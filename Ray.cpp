@@ -8,7 +8,8 @@
 /* In the constructor, we set the starting point of the ray. */
 Ray::Ray(double x, double y, double z, int w, int h):
     wPos(w),
-    hPos(h)
+    hPos(h),
+    sample(0)
 {
     origin.x = x;
     origin.y = y;
@@ -23,35 +24,38 @@ Ray::Ray(double x, double y, double z, int w, int h):
     distanceToLight = 0;
 }
 
+Ray::Ray() {}
 //Destructor
 Ray::~Ray() {}
 
-void Ray::operator = (Ray& newRay)
+Ray& Ray::operator = (const Ray& newRay)
 {
     /* Make sure it's not the same object. */
     if (this != &newRay)
     {
         /* COPIES: */
         /* The W and H positions...*/
-        newRay.setWPos(wPos);
-        newRay.setHPos(hPos);
+        wPos = newRay.wPos;
+        hPos = newRay.hPos;
+        sample = newRay.sample;
 
         /* The origin... */
-        newRay.setOrigin(origin);
+        origin = newRay.origin;
 
         /* The direction... */
-        newRay.setDirection(direction);
+        direction = newRay.direction;
 
         /* The colour...*/
-        newRay.setR(c.r);
-        newRay.setG(c.g);
-        newRay.setB(c.b);
+        c = newRay.c;
 
         /* The intensity...*/
-        newRay.setIntensity(intensity);
-        
+        intensity = newRay.intensity;
+
+        /* And whether it goes to a light. */
+        isToLight = newRay.isToLight;
+        distanceToLight = newRay.distanceToLight;
     }
-    return;
+    return *this;
 }
 
 /* Sets the direction of the ray. */
@@ -83,6 +87,8 @@ int Ray::getWPos() { return wPos; }
 int Ray::getHPos() { return hPos; }
 void Ray::setWPos(int v) { wPos = v; }
 void Ray::setHPos(int v) { hPos = v; }
+int Ray::getSample() { return sample; }
+void Ray::setSample(int v) { sample = v; }
 
 /* Ray coordinates. */
 vector Ray::getDir() {return direction;}
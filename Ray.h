@@ -1 +1,79 @@
-#ifndef _H_Ray#define _H_Ray/* Needed libraries. */#include <string>/* Defines the needed classes and their headers. */class Sphere;class Plane;#include "BasicStructures.h"/* Header for the Ray class. */class Ray{private:    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/    /* The starting point of the ray and its direction. */    point origin;    vector direction;    /* The corresponding pixel in the final image for this ray. */    int wPos, hPos;    /* The colour for this ray. */    colour c;    double intensity;    /* If this is a ray cast from the camera or a ray that connects an     * intersection point to a light.     */    bool isToLight;    double distanceToLight;        public:    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/    /* Constructor & destructor. */    explicit Ray(double x, double y, double z, int w, int h);    ~Ray();    void operator = (Ray& newRay);    /* - - - - - - - OTHER METHODS - - - - - - - -*/    void normalize();    /* Sets the new direction of the ray after an intersection. */    double normalizeColour();    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/    int getWPos();    int getHPos();    void setWPos(int v);    void setHPos(int v);    vector getDir();    point getOrigin();    void setDirection(double x, double y, double z);    void setDirection(vector v);    void setOrigin(point p);    void setIsToLight(bool v, double d);    bool isToLightRay();    double getToLightDistance();    double getR();    double getG();    double getB();    void setR(double v);    void setG(double v);    void setB(double v);    void increaseR(double per);    void increaseG(double per);    void increaseB(double per);    double getIntensity();    void setIntensity(double v);    void multIntensity(double v);};#endif
\ No newline at end of file
+#ifndef _H_Ray
+#define _H_Ray
+
+/* Needed libraries. */
+#include <string>
+
+/* Defines the needed classes and their headers. */
+class Sphere;
+class Plane;
+#include "BasicStructures.h"
+
+/* Header for the Ray class. */
+class Ray
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* The starting point of the ray and its direction. */
+    point origin;
+    vector direction;
+    /* The corresponding pixel in the final image for this ray, and which
+     * of its samples it is, 0 being the one at its centre.
+     */
+    int wPos, hPos;
+    int sample;
+    /* The colour for this ray. */
+    colour c;
+    double intensity;
+    /* If this is a ray cast from the camera or a ray that connects an
+     * intersection point to a light.
+     */
+    bool isToLight;
+    double distanceToLight;
+        
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Ray(double x, double y, double z, int w, int h);
+    explicit Ray();
+    ~Ray();
+    Ray& operator = (const Ray& newRay);
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    void normalize();
+    /* Sets the new direction of the ray after an intersection. */
+    double normalizeColour();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getWPos();
+    int getHPos();
+    void setWPos(int v);
+    void setHPos(int v);
+    int getSample();
+    void setSample(int v);
+    vector getDir();
+    point getOrigin();
+    void setDirection(double x, double y, double z);
+    void setDirection(vector v);
+    void setOrigin(point p);
+    void setIsToLight(bool v, double d);
+    bool isToLightRay();
+    double getToLightDistance();
+
+    double getR();
+    double getG();
+    double getB();
+    void setR(double v);
+    void setG(double v);
+    void setB(double v);
+    void increaseR(double per);
+    void increaseG(double per);
+    void increaseB(double per);
+
+    double getIntensity();
+    void setIntensity(double v);
+    void multIntensity(double v);
+
+};
+
+#endif
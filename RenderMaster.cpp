@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <algorithm>
+
+/* Defines the needed classes and their headers. */
+#include "RenderMaster.h"
+#include "TileQueue.h"
+
+using namespace std;
+
+/* What the thread that serves a worker needs to know. */
+struct workerLink
+{
+    RenderMaster *master;
+    Socket *socket;
+    int id;
+};
+
+/* Constructor. */
+RenderMaster::RenderMaster(int port, Message *job, RenderRegion *region):
+    port(port),
+    job(job),
+    region(region),
+    noDone(0),
+    noWorkers(0),
+    noAlive(0),
+    nextPending(0)
+{
+    int i, noTiles = region->getNoTiles();
+    int columns = (region->getWidth() + TILE_SIZE - 1) / TILE_SIZE;
+
+    state = new int[noTiles];
+    owner = new int[noTiles];
+    given = new int[noTiles];
+    noPending = noTiles;
+
+    regionTile = new int[region->getNoGridTiles()];
+    for (i = 0; i < region->getNoGridTiles(); i++)
+        regionTile[i] = -1;
+
+    for (i = 0; i < noTiles; i++)
+    {
+        tile t = region->getTile(i);
+        state[i] = TILE_PENDING;
+        owner[i] = -1;
+        given[i] = 0;
+        regionTile[(t.y / TILE_SIZE) * columns + t.x / TILE_SIZE] = i;
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+}
+
+/* Destructor. */
+RenderMaster::~RenderMaster()
+{
+    listener.close();
+    delete [] state;
+    delete [] owner;
+    delete [] given;
+    delete [] regionTile;
+    pthread_mutex_destroy(&mutex);
+}
+
+bool RenderMaster::start()
+{
+    if (!listener.listen(NULL, port))
+        return false;
+
+    printf("Waiting for workers on port %d.\n", port);
+    pthread_create(&thread, NULL, acceptWorkers, this);
+    return true;
+}
+
+/* Each worker that connects is served by its own thread. */
+void *RenderMaster::acceptWorkers(void *master)
+{
+    RenderMaster *m = (RenderMaster *) master;
+    Socket *s;
+    pthread_t worker;
+
+    while ((s = m->listener.accept()) != NULL)
+    {
+        workerLink *link = new workerLink;
+        link->master = m;
+        link->socket = s;
+
+        pthread_mutex_lock(&m->mutex);
+        link->id = m->noWorkers++;
+        m->noAlive++;
+        pthread_mutex_unlock(&m->mutex);
+
+        pthread_create(&worker, NULL, serveWorker, link);
+        pthread_detach(worker);
+    }
+
+    return NULL;
+}
+
+/* Sends the job to a worker, then answers it until it leaves. */
+void *RenderMaster::serveWorker(void *link)
+{
+    workerLink *l = (workerLink *) link;
+    RenderMaster *m = l->master;
+    Message in, out;
+    int type, i, n, tiles[MAX_GIVEN_TILES];
+
+    printf("Worker %d joined.\n", l->id);
+
+    if (m->job->send(l->socket, MESSAGE_JOB))
+        while (in.receive(l->socket, type))
+        {
+            if (type == MESSAGE_PIXELS)
+            {
+                if (!m->finishTile(in))
+                    break;
+                continue;
+            }
+
+            if (type != MESSAGE_ASK)
+                break;
+
+            out.clear();
+            n = m->giveTiles(l->id, tiles);
+
+            if (n < 0)
+            {
+                if (!out.send(l->socket, MESSAGE_DONE))
+                    break;
+                continue;
+            }
+
+            out.putInt(n);
+            for (i = 0; i < n; i++)
+            {
+                tile t = m->region->getTile(tiles[i]);
+                out.putInt(t.x);
+                out.putInt(t.y);
+                out.putInt(t.width);
+                out.putInt(t.height);
+            }
+
+            if (!out.send(l->socket, MESSAGE_TILES))
+                break;
+        }
+
+    m->loseWorker(l->id);
+    printf("Worker %d left.\n", l->id);
+
+    delete l->socket;
+    delete l;
+    return NULL;
+}
+
+/* Chooses the tiles for a worker that asks, and returns how many they
+ * are, or -1 if the image is done.
+ */
+int RenderMaster::giveTiles(int worker, int *tiles)
+{
+    int i, n = 0, noTiles = region->getNoTiles();
+
+    pthread_mutex_lock(&mutex);
+
+    if (noDone == noTiles)
+    {
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    /* A share of what is left, so the last tiles are spread among all the
+     * workers.
+     */
+    int share = max(1, min(noPending / (4 * max(noAlive, 1)), MAX_GIVEN_TILES));
+
+    for (; nextPending < noTiles && n < share; nextPending++)
+        if (state[nextPending] == TILE_PENDING)
+            tiles[n++] = nextPending;
+
+    /* Nothing is left to give, so we give the tile that was given fewer
+     * times to another worker.
+     */
+    if (n == 0)
+    {
+        int best = -1;
+
+        for (i = 0; i < noTiles; i++)
+            if (state[i] == TILE_GIVEN && owner[i] != worker && given[i] < 2 &&
+                    (best < 0 || given[i] < given[best]))
+                best = i;
+
+        if (best >= 0)
+            tiles[n++] = best;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (state[tiles[i]] == TILE_PENDING)
+            noPending--;
+
+        state[tiles[i]] = TILE_GIVEN;
+        owner[tiles[i]] = worker;
+        given[tiles[i]]++;
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return n;
+}
+
+/* Keeps the pixels of a tile sent by a worker, unless another one sent
+ * them first. Returns false if the message isn't right.
+ */
+bool RenderMaster::finishTile(Message &m)
+{
+    colour pixels[TILE_SIZE * TILE_SIZE];
+    int k, columns = (region->getWidth() + TILE_SIZE - 1) / TILE_SIZE;
+    tile t;
+
+    t.x = m.getInt();
+    t.y = m.getInt();
+    t.width = m.getInt();
+    t.height = m.getInt();
+
+    if (t.x < 0 || t.y < 0 || t.x >= region->getWidth() || t.y >= region->getHeight())
+        return false;
+
+    int i = regionTile[(t.y / TILE_SIZE) * columns + t.x / TILE_SIZE];
+    if (i < 0)
+        return false;
+
+    tile r = region->getTile(i);
+    if (r.x != t.x || r.y != t.y || r.width != t.width || r.height != t.height)
+        return false;
+
+    for (k = 0; k < t.width * t.height; k++)
+        pixels[k] = m.getColour();
+
+    if (!m.isValid())
+        return false;
+
+    pthread_mutex_lock(&mutex);
+    bool first = state[i] != TILE_DONE;
+    if (first)
+    {
+        if (state[i] == TILE_PENDING)
+            noPending--;
+        state[i] = TILE_DONE;
+        noDone++;
+    }
+    bool last = first && noDone == region->getNoTiles();
+    int workers = noWorkers;
+    pthread_mutex_unlock(&mutex);
+
+    if (first)
+        storeTile(t.x, t.y, t.width, t.height, pixels);
+
+    if (last)
+        printf("Image traced by %d workers.\n", workers);
+
+    return true;
+}
+
+/* The tiles a lost worker still had are given again. */
+void RenderMaster::loseWorker(int worker)
+{
+    int i;
+
+    pthread_mutex_lock(&mutex);
+
+    for (i = 0; i < region->getNoTiles(); i++)
+        if (state[i] == TILE_GIVEN && owner[i] == worker)
+        {
+            state[i] = TILE_PENDING;
+            owner[i] = -1;
+            noPending++;
+            nextPending = min(nextPending, i);
+        }
+
+    noAlive--;
+    pthread_mutex_unlock(&mutex);
+}
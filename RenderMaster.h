@@ -0,0 +1,70 @@
+#ifndef _H_RenderMaster
+#define _H_RenderMaster
+
+/* Needed libraries. */
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Socket.h"
+#include "Message.h"
+#include "RenderRegion.h"
+
+/* The state of each tile of the region. */
+#define TILE_PENDING 0
+#define TILE_GIVEN 1
+#define TILE_DONE 2
+
+/* The most tiles given to a worker at once. */
+#define MAX_GIVEN_TILES 8
+
+/* Header for the RenderMaster class. Instead of tracing the image, it waits
+ * for workers, which may join at any time and from any machine, sends each
+ * one the job, and hands out the tiles of the region as they ask for them.
+ * While many tiles are left each worker gets a few at once, fewer as the
+ * end draws near. Then, a worker with nothing to do is given a tile that
+ * another one still holds, and whichever finishes it first wins, so no
+ * worker waits for a slow one, nor for one that was lost.
+ */
+class RenderMaster
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int port;
+    Socket listener;
+    Message *job;
+    RenderRegion *region;
+
+    /* For each tile of the region, its state, the worker that has it and
+     * how many times it was given. Then, the tile of the region that each
+     * tile of the image became, or -1.
+     */
+    int *state, *owner, *given;
+    int *regionTile;
+    /* How many tiles are done and how many are left to give; how many
+     * workers came, and how many are still here; and the first tile that
+     * may still be left to give.
+     */
+    int noDone, noPending;
+    int noWorkers, noAlive;
+    int nextPending;
+    pthread_mutex_t mutex;
+    pthread_t thread;
+
+    static void *acceptWorkers(void *master);
+    static void *serveWorker(void *link);
+    int giveTiles(int worker, int *tiles);
+    bool finishTile(Message &m);
+    void loseWorker(int worker);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit RenderMaster(int port, Message *job, RenderRegion *region);
+    ~RenderMaster();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Starts to wait for workers. Returns false if the port can't be used. */
+    bool start();
+};
+
+#endif
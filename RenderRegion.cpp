@@ -0,0 +1,114 @@
+#include <algorithm>
+
+/* Defines the needed classes and their headers. */
+#include "RenderRegion.h"
+
+using namespace std;
+
+/* In the constructor, we find the tiles to trace. Each tile of the image
+ * in the range is cut to the rectangle, so the tiles of the parts of an
+ * image traced apart are the same as when it is traced at once.
+ */
+RenderRegion::RenderRegion(int width, int height, int cropX, int cropY, int cropWidth, int cropHeight,
+        int firstTile, int lastTile):
+    width(width),
+    height(height),
+    noTiles(0),
+    noPixels(0)
+{
+    int i;
+
+    this->cropX = max(cropX, 0);
+    this->cropY = max(cropY, 0);
+    this->cropWidth = max(min(cropX + cropWidth, width) - this->cropX, 0);
+    this->cropHeight = max(min(cropY + cropHeight, height) - this->cropY, 0);
+    this->firstTile = max(firstTile, 0);
+    this->lastTile = lastTile < 0 ? getNoGridTiles() - 1 : min(lastTile, getNoGridTiles() - 1);
+
+    tiles = new tile[max(this->lastTile - this->firstTile + 1, 1)];
+
+    for (i = this->firstTile; i <= this->lastTile; i++)
+    {
+        tile t = getGridTile(i);
+        int x = max(t.x, this->cropX);
+        int y = max(t.y, this->cropY);
+        int right = min(t.x + t.width, this->cropX + this->cropWidth);
+        int bottom = min(t.y + t.height, this->cropY + this->cropHeight);
+
+        if (right > x && bottom > y)
+        {
+            tile cut = {x, y, right - x, bottom - y};
+            tiles[noTiles++] = cut;
+            noPixels += cut.width * cut.height;
+        }
+    }
+}
+
+/* Destructor. */
+RenderRegion::~RenderRegion()
+{
+    delete [] tiles;
+}
+
+/* The tile i of the whole image. */
+tile RenderRegion::getGridTile(int i)
+{
+    int columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tile t;
+
+    t.x = (i % columns) * TILE_SIZE;
+    t.y = (i / columns) * TILE_SIZE;
+    t.width = min(TILE_SIZE, width - t.x);
+    t.height = min(TILE_SIZE, height - t.y);
+
+    return t;
+}
+
+int RenderRegion::getUntraced(int i, tile *parts)
+{
+    tile t = getGridTile(i);
+    int x = max(t.x, cropX);
+    int y = max(t.y, cropY);
+    int right = min(t.x + t.width, cropX + cropWidth);
+    int bottom = min(t.y + t.height, cropY + cropHeight);
+
+    /* Out of the range, or of the rectangle, nothing of it is traced. */
+    if (i < firstTile || i > lastTile || right <= x || bottom <= y)
+    {
+        parts[0] = t;
+        return 1;
+    }
+
+    /* Or else, the rows above and below the traced part, and the pixels
+     * to its sides.
+     */
+    int noParts = 0;
+    tile above = {t.x, t.y, t.width, y - t.y};
+    tile below = {t.x, bottom, t.width, t.y + t.height - bottom};
+    tile left = {t.x, y, x - t.x, bottom - y};
+    tile rightSide = {right, y, t.x + t.width - right, bottom - y};
+
+    if (above.height > 0)
+        parts[noParts++] = above;
+    if (below.height > 0)
+        parts[noParts++] = below;
+    if (left.width > 0)
+        parts[noParts++] = left;
+    if (rightSide.width > 0)
+        parts[noParts++] = rightSide;
+
+    return noParts;
+}
+
+int RenderRegion::getWidth() { return width; }
+int RenderRegion::getHeight() { return height; }
+int RenderRegion::getNoTiles() { return noTiles; }
+tile RenderRegion::getTile(int i) { return tiles[i]; }
+long long RenderRegion::getNoPixels() { return noPixels; }
+
+int RenderRegion::getNoGridTiles()
+{
+    return ((width + TILE_SIZE - 1) / TILE_SIZE) * ((height + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+bool RenderRegion::isWhole() { return noPixels == (long long) width * height; }
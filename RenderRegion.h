@@ -0,0 +1,55 @@
+#ifndef _H_RenderRegion
+#define _H_RenderRegion
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "TileQueue.h"
+
+/* Header for the RenderRegion class. It is the part of the image that this
+ * process traces: the tiles of the image whose numbers are in a range, cut
+ * to a rectangle. The tiles are numbered row after row from the bottom
+ * left of the image, where y is 0, so many processes may each trace a part
+ * of the same image and tileTool puts them together.
+ */
+class RenderRegion
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int width, height;
+    int cropX, cropY, cropWidth, cropHeight;
+    int firstTile, lastTile;
+
+    /* The tiles to trace, in their order, and the pixels in all of them. */
+    int noTiles;
+    tile *tiles;
+    long long noPixels;
+
+    tile getGridTile(int i);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. The rectangle and the range are cut to the
+     * image, and a negative lastTile is its last tile.
+     */
+    explicit RenderRegion(int width, int height, int cropX, int cropY, int cropWidth, int cropHeight,
+            int firstTile, int lastTile);
+    ~RenderRegion();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Gives the parts of the tile i of the image that aren't traced, at most
+     * four, and returns how many they are.
+     */
+    int getUntraced(int i, tile *parts);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getWidth();
+    int getHeight();
+    int getNoTiles();
+    tile getTile(int i);
+    long long getNoPixels();
+    /* How many tiles the whole image has. */
+    int getNoGridTiles();
+    /* If the whole image is traced. */
+    bool isWhole();
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <stdio.h>
+
+/* Defines the needed classes and their headers. */
+#include "RenderServer.h"
+#include "Sampler.h"
+#include "TileQueue.h"
+#include "OutputStage.h"
+#include "RenderRegion.h"
+
+/* The settings of the render, and the scene being traced. */
+extern int imageWidth, imageHeight;
+extern colour image[SCREEN_W][SCREEN_H];
+extern int maxSamples, samplePattern;
+extern Sampler *sampler;
+extern RenderRegion *region;
+extern TileQueue *tileQueue;
+extern int outputFilter;
+extern double exposure, outputGamma;
+extern bool tonemap;
+extern OutputStage *outputStage;
+extern point camera;
+extern int visualizationType;
+extern long long fadingCoeficient;
+extern long long fullLightLimit;
+
+/* Constructor. What the scenes start with is what the program started
+ * with.
+ */
+RenderServer::RenderServer(int port):
+    port(port),
+    cache(SCENE_CACHE_SIZE),
+    noJobs(0),
+    defaultCamera(camera),
+    defaultVisualization(visualizationType),
+    defaultFading(fadingCoeficient),
+    defaultFullLight(fullLightLimit)
+{ }
+
+/* Destructor. */
+RenderServer::~RenderServer() { }
+
+void RenderServer::run()
+{
+    Message request;
+    Socket *client;
+    int type;
+
+    /* The jobs are not checked for who sends them, so only the clients of
+     * this machine may connect.
+     */
+    if (!listener.listen("127.0.0.1", port))
+    {
+        printf("Could not wait for clients on port %d.\n", port);
+        return;
+    }
+
+    printf("Waiting for jobs on port %d of this machine.\n", port);
+
+    while ((client = listener.accept()) != NULL)
+    {
+        while (request.receive(client, type) && type == MESSAGE_RENDER)
+            if (!serveJob(request, client))
+                break;
+
+        delete client;
+    }
+}
+
+/* Makes the scene of the job the one traced, from the cache if it is kept
+ * there, or else building it and keeping it.
+ */
+bool RenderServer::selectScene(Message &request, int source, bool &cached)
+{
+    unsigned long long key;
+    int number = 0;
+
+    if (source == SCENE_NUMBER)
+    {
+        Message name;
+        number = request.getInt();
+        name.putInt(SCENE_NUMBER);
+        name.putInt(number);
+        key = name.hashRest();
+    }
+    else
+        key = request.hashRest();
+
+    cached = cache.use(key);
+    if (cached)
+        return true;
+
+    if (source == SCENE_NUMBER)
+    {
+        camera = defaultCamera;
+        visualizationType = defaultVisualization;
+        fadingCoeficient = defaultFading;
+        fullLightLimit = defaultFullLight;
+        buildScene(number);
+    }
+    else if (!unpackScene(request))
+    {
+        freeScene();
+        return false;
+    }
+
+    buildAccelerator();
+    buildShadowOccluders();
+    cache.keep(key);
+    return true;
+}
+
+/* Traces one job, with the threads of the pool, and sends back what was
+ * asked. Returns false if the request isn't right or the client is lost.
+ */
+bool RenderServer::serveJob(Message &request, Socket *client)
+{
+    Message reply;
+    int i, j;
+    bool cached;
+
+    int source = request.getInt();
+    int width = request.getInt();
+    int height = request.getInt();
+    int samples = request.getInt();
+    int replyType = request.getInt();
+    bool ownCamera = request.getInt() != 0;
+    point jobCamera = request.getPoint();
+
+    if (!request.isValid() || (source != SCENE_NUMBER && source != SCENE_INLINE) ||
+            width < 1 || width > SCREEN_W || height < 1 || height > SCREEN_H || samples < 1 ||
+            (replyType != REPLY_IMAGE && replyType != REPLY_TILES))
+        return false;
+
+    if (!selectScene(request, source, cached))
+        return false;
+
+    if (ownCamera)
+        camera = jobCamera;
+
+    printf("Job %d: %dx%d, %d samples, scene %s.\n", ++noJobs, width, height, samples,
+            cached ? "kept" : "built");
+
+    /* Everything that depends on the size of the image, or the samples. */
+    imageWidth = width;
+    imageHeight = height;
+    if (samples != maxSamples || sampler == NULL)
+    {
+        delete sampler;
+        maxSamples = samples;
+        sampler = new Sampler(samplePattern, maxSamples);
+    }
+
+    delete region;
+    delete tileQueue;
+    delete outputStage;
+    region = new RenderRegion(imageWidth, imageHeight, 0, 0, imageWidth, imageHeight, 0, -1);
+    tileQueue = new TileQueue(region->getNoTiles());
+    outputStage = new OutputStage(imageWidth, imageHeight, outputFilter, exposure, tonemap, outputGamma);
+
+    startRender();
+
+    /* The tiles are sent as they come, and we sleep while none comes. */
+    bool connected = true;
+    int received = 0;
+    tile t;
+
+    while (received < region->getNoTiles())
+    {
+        tileQueue->take(t);
+
+        received++;
+        if (replyType != REPLY_TILES || !connected)
+            continue;
+
+        reply.clear();
+        reply.putInt(t.x);
+        reply.putInt(t.y);
+        reply.putInt(t.width);
+        reply.putInt(t.height);
+        for (j = t.y; j < t.y + t.height; j++)
+            for (i = t.x; i < t.x + t.width; i++)
+                reply.putColour(image[i][j]);
+
+        connected = reply.send(client, MESSAGE_PIXELS);
+    }
+
+    finishRender();
+
+    if (connected && replyType == REPLY_IMAGE)
+    {
+        outputStage->resolve(0, 0, imageWidth, imageHeight);
+
+        reply.clear();
+        reply.putInt(imageWidth);
+        reply.putInt(imageHeight);
+        reply.putBytes(outputStage->getPixels(), imageWidth * imageHeight * 3);
+        connected = reply.send(client, MESSAGE_IMAGE);
+    }
+
+    reply.clear();
+    reply.putInt(cached);
+    return connected && reply.send(client, MESSAGE_DONE);
+}
@@ -0,0 +1,67 @@
+#ifndef _H_RenderServer
+#define _H_RenderServer
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Socket.h"
+#include "Message.h"
+#include "SceneCache.h"
+
+/* Where the scene of a job comes from: the number of one of the scenes
+ * built in, or the scene itself, as written by packScene().
+ */
+#define SCENE_NUMBER 1
+#define SCENE_INLINE 2
+
+/* What the client gets back: the whole image once it is done, or the
+ * pixels of each tile as soon as it is traced.
+ */
+#define REPLY_IMAGE 1
+#define REPLY_TILES 2
+
+/* How many scenes the server keeps. */
+#define SCENE_CACHE_SIZE 4
+
+/* Header for the RenderServer class. It stays running and traces the jobs
+ * its clients send, one at a time. A job is a MESSAGE_RENDER with where
+ * its scene comes from, the size of the image, the samples of each pixel,
+ * the reply wanted and, if it has one, its own camera; then the number of
+ * the scene, or the scene. The scenes stay built in a SceneCache, so a job
+ * for one traced before only pays for the tracing. Only the clients of the
+ * same machine may connect.
+ *
+ * The tiles come back as MESSAGE_PIXELS, as from a worker, and the image
+ * as MESSAGE_IMAGE: its width, its height and its pixels in RGB, one row
+ * after the other from the bottom. Each job ends with MESSAGE_DONE, which
+ * tells if the scene was already kept.
+ */
+class RenderServer
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int port;
+    Socket listener;
+    SceneCache cache;
+    int noJobs;
+
+    /* What a scene built in starts with. */
+    point defaultCamera;
+    int defaultVisualization;
+    long long defaultFading, defaultFullLight;
+
+    bool serveJob(Message &request, Socket *client);
+    bool selectScene(Message &request, int source, bool &cached);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit RenderServer(int port);
+    ~RenderServer();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Serves the clients, one after the other. Returns only if the port
+     * can't be used.
+     */
+    void run();
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "RenderWorker.h"
+
+/* Constructor. */
+RenderWorker::RenderWorker(const char *host, int port):
+    port(port),
+    noBatch(0),
+    nextInBatch(0),
+    finished(false)
+{
+    this->host = new char[strlen(host) + 1];
+    strcpy(this->host, host);
+    pthread_mutex_init(&mutex, NULL);
+}
+
+/* Destructor. */
+RenderWorker::~RenderWorker()
+{
+    delete [] host;
+    pthread_mutex_destroy(&mutex);
+}
+
+bool RenderWorker::connect(Message &job)
+{
+    int type;
+
+    if (!socket.connect(host, port))
+        return false;
+
+    return job.receive(&socket, type) && type == MESSAGE_JOB;
+}
+
+bool RenderWorker::nextTile(tile &t)
+{
+    int i, type;
+
+    pthread_mutex_lock(&mutex);
+
+    while (!finished && nextInBatch == noBatch)
+    {
+        message.clear();
+        if (!message.send(&socket, MESSAGE_ASK) || !message.receive(&socket, type) || type != MESSAGE_TILES)
+        {
+            finished = true;
+            break;
+        }
+
+        noBatch = message.getInt();
+        nextInBatch = 0;
+        if (noBatch < 0 || noBatch > MAX_GIVEN_TILES)
+            noBatch = 0;
+
+        for (i = 0; i < noBatch; i++)
+        {
+            batch[i].x = message.getInt();
+            batch[i].y = message.getInt();
+            batch[i].width = message.getInt();
+            batch[i].height = message.getInt();
+        }
+
+        /* The other workers still have the last tiles, and one of them may
+         * be lost, so we ask again a bit later.
+         */
+        if (noBatch == 0)
+        {
+            pthread_mutex_unlock(&mutex);
+#ifdef _WIN32
+            Sleep(WORKER_WAIT);
+#else
+            usleep(WORKER_WAIT * 1000);
+#endif
+            pthread_mutex_lock(&mutex);
+        }
+    }
+
+    bool found = !finished;
+    if (found)
+        t = batch[nextInBatch++];
+
+    pthread_mutex_unlock(&mutex);
+    return found;
+}
+
+void RenderWorker::sendTile(tile t, colour *pixels)
+{
+    int i;
+
+    pthread_mutex_lock(&mutex);
+
+    message.clear();
+    message.putInt(t.x);
+    message.putInt(t.y);
+    message.putInt(t.width);
+    message.putInt(t.height);
+    for (i = 0; i < t.width * t.height; i++)
+        message.putColour(pixels[i]);
+
+    if (!message.send(&socket, MESSAGE_PIXELS))
+        finished = true;
+
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,58 @@
+#ifndef _H_RenderWorker
+#define _H_RenderWorker
+
+/* Needed libraries. */
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Socket.h"
+#include "Message.h"
+#include "TileQueue.h"
+#include "RenderMaster.h"
+
+/* How long, in milliseconds, a worker waits before it asks again when the
+ * master has nothing to give yet.
+ */
+#define WORKER_WAIT 20
+
+/* Header for the RenderWorker class. It is the link of a worker process to
+ * its master: it receives the job, then the threads ask it for the tiles to
+ * trace and send the pixels of each one back through it. They all share
+ * the connection, one at a time.
+ */
+class RenderWorker
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    char *host;
+    int port;
+    Socket socket;
+    Message message;
+    pthread_mutex_t mutex;
+
+    /* The tiles given by the master that no thread has taken yet, and if
+     * there will be no more.
+     */
+    tile batch[MAX_GIVEN_TILES];
+    int noBatch, nextInBatch;
+    bool finished;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit RenderWorker(const char *host, int port);
+    ~RenderWorker();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Connects to the master and waits for the job. Returns false if it
+     * can't be had.
+     */
+    bool connect(Message &job);
+    /* Gives the next tile to trace. Returns false when the image is done. */
+    bool nextTile(tile &t);
+    /* Sends the mean colour of each pixel of a tile, row after row. */
+    void sendTile(tile t, colour *pixels);
+};
+
+#endif
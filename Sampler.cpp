@@ -0,0 +1,150 @@
+#include <cmath>
+
+/* Defines the needed classes and their headers. */
+#include "Sampler.h"
+
+/* Mixes the bits of the given numbers into a value in [0, 1). It stands for
+ * a random number that is always the same for the same pixel and sample.
+ */
+static double hashToUnit(unsigned int x, unsigned int y, unsigned int i)
+{
+    unsigned int h = x * 0x8da6b343u ^ y * 0xd8163841u ^ i * 0xcb1ab31fu;
+
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+
+    return h / 4294967296.0;
+}
+
+/* The radical inverse of i in the given base. */
+static double radicalInverse(int i, int base)
+{
+    double value = 0, digit = 1.0 / base;
+
+    while (i > 0)
+    {
+        value += (i % base) * digit;
+        i /= base;
+        digit /= base;
+    }
+
+    return value;
+}
+
+/* In the constructor, we build the points shared by every pixel. */
+Sampler::Sampler(int pattern, int noSamples):
+    pattern(pattern),
+    noSamples(noSamples < 1 ? 1 : noSamples),
+    pointsX(NULL),
+    pointsY(NULL)
+{
+    /* The strata are as close to square as the number of samples allows. */
+    columns = (int) ceil(sqrt((double) this->noSamples));
+    rows = (this->noSamples + columns - 1) / columns;
+
+    if (pattern == SAMPLER_HALTON)
+        buildHalton();
+    else if (pattern == SAMPLER_BLUE_NOISE)
+        buildBlueNoise();
+}
+
+/* Destructor. */
+Sampler::~Sampler()
+{
+    delete [] pointsX;
+    delete [] pointsY;
+}
+
+/* The first points of the Halton sequence in bases 2 and 3. They fill the
+ * square evenly for any number of samples, not only for squares.
+ */
+void Sampler::buildHalton()
+{
+    int i;
+
+    pointsX = new double[noSamples];
+    pointsY = new double[noSamples];
+
+    for (i = 0; i < noSamples; i++)
+    {
+        pointsX[i] = radicalInverse(i + 1, 2);
+        pointsY[i] = radicalInverse(i + 1, 3);
+    }
+}
+
+/* Mitchell's best candidate algorithm. Each new point is the one, among
+ * several random candidates, that stands furthest from all the points we
+ * already have. Distances wrap around the square, since the pattern is
+ * shifted inside each pixel.
+ */
+void Sampler::buildBlueNoise()
+{
+    int i, j, k;
+
+    pointsX = new double[noSamples];
+    pointsY = new double[noSamples];
+
+    for (i = 0; i < noSamples; i++)
+    {
+        double bestDistance = -1;
+
+        for (k = 0; k < 10 * i + 1; k++)
+        {
+            double cx = hashToUnit(i, k, 0);
+            double cy = hashToUnit(i, k, 1);
+            double closest = 2;
+
+            for (j = 0; j < i; j++)
+            {
+                double dx = fabs(cx - pointsX[j]);
+                double dy = fabs(cy - pointsY[j]);
+                dx = dx > 0.5 ? 1 - dx : dx;
+                dy = dy > 0.5 ? 1 - dy : dy;
+
+                if (dx*dx + dy*dy < closest)
+                    closest = dx*dx + dy*dy;
+            }
+
+            if (closest > bestDistance)
+            {
+                bestDistance = closest;
+                pointsX[i] = cx;
+                pointsY[i] = cy;
+            }
+        }
+    }
+}
+
+void Sampler::getSample(int x, int y, int i, double &sx, double &sy)
+{
+    double u, v;
+
+    if (pattern == SAMPLER_HALTON || pattern == SAMPLER_BLUE_NOISE)
+    {
+        /* The shared points, shifted by the offset of this pixel. */
+        u = pointsX[i % noSamples] + hashToUnit(x, y, 0);
+        v = pointsY[i % noSamples] + hashToUnit(x, y, 1);
+        u -= floor(u);
+        v -= floor(v);
+    }
+    else
+    {
+        /* A random point inside the stratum of this sample. The last row
+         * may have fewer strata, which are then made wider.
+         */
+        int stratum = i % noSamples;
+        int row = stratum / columns;
+        int inRow = row == rows - 1 ? noSamples - row * columns : columns;
+        u = (stratum % columns + hashToUnit(x, y, 2*i)) / inRow;
+        v = (row + hashToUnit(x, y, 2*i + 1)) / rows;
+    }
+
+    sx = x + u;
+    sy = y + v;
+}
+
+int Sampler::getPattern() { return pattern; }
+int Sampler::getNoSamples() { return noSamples; }
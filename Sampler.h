@@ -0,0 +1,45 @@
+#ifndef _H_Sampler
+#define _H_Sampler
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+
+/* Header for the Sampler class. It gives the positions, inside a pixel, of
+ * the samples traced through it. The positions only depend on the pixel and
+ * on the number of the sample, so a tile looks the same whichever thread
+ * traces it, and whenever.
+ */
+class Sampler
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* One of the SAMPLER_ patterns and the samples of each pixel. */
+    int pattern;
+    int noSamples;
+    /* The columns and rows of the strata, for the stratified pattern. */
+    int columns, rows;
+    /* The points, in the unit square, shared by all the pixels in the
+     * Halton and blue noise patterns. Each pixel shifts them by its own
+     * offset, so neighbours don't repeat the same pattern.
+     */
+    double *pointsX;
+    double *pointsY;
+
+    void buildHalton();
+    void buildBlueNoise();
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Sampler(int pattern, int noSamples);
+    ~Sampler();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Gives the position, in pixels, of the sample i of the pixel (x, y). */
+    void getSample(int x, int y, int i, double &sx, double &sy);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getPattern();
+    int getNoSamples();
+};
+
+#endif
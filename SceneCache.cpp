@@ -0,0 +1,101 @@
+/* Defines the needed classes and their headers. */
+#include "SceneCache.h"
+
+/* The scene being traced. */
+extern int noObjects, noLights;
+extern Object **objects;
+extern Light *lights;
+extern Arena *sceneArena;
+extern BVH *bvh;
+extern point camera;
+extern int visualizationType;
+extern long long fadingCoeficient;
+extern long long fullLightLimit;
+
+/* Constructor. */
+SceneCache::SceneCache(int capacity):
+    capacity(capacity < 1 ? 1 : capacity),
+    noScenes(0),
+    clock(0)
+{
+    scenes = new cachedScene[this->capacity];
+}
+
+/* Destructor. */
+SceneCache::~SceneCache()
+{
+    int i;
+
+    for (i = 0; i < noScenes; i++)
+        freeScene(scenes[i]);
+
+    delete [] scenes;
+}
+
+/* The objects and lights go with their arena. */
+void SceneCache::freeScene(cachedScene &s)
+{
+    int i;
+
+    for (i = 0; i < s.noLights; i++)
+        s.lights[i].freeOccluders();
+
+    delete s.bvh;
+    delete s.arena;
+}
+
+bool SceneCache::use(unsigned long long key)
+{
+    int i;
+
+    for (i = 0; i < noScenes; i++)
+        if (scenes[i].key == key)
+        {
+            sceneArena = scenes[i].arena;
+            bvh = scenes[i].bvh;
+            noObjects = scenes[i].noObjects;
+            objects = scenes[i].objects;
+            noLights = scenes[i].noLights;
+            lights = scenes[i].lights;
+            camera = scenes[i].camera;
+            visualizationType = scenes[i].visualizationType;
+            fadingCoeficient = scenes[i].fadingCoeficient;
+            fullLightLimit = scenes[i].fullLightLimit;
+            scenes[i].lastUse = ++clock;
+            return true;
+        }
+
+    return false;
+}
+
+void SceneCache::keep(unsigned long long key)
+{
+    int i, slot = noScenes;
+
+    /* The scene not traced for the longest time makes room. */
+    if (noScenes == capacity)
+    {
+        slot = 0;
+        for (i = 1; i < noScenes; i++)
+            if (scenes[i].lastUse < scenes[slot].lastUse)
+                slot = i;
+
+        freeScene(scenes[slot]);
+    }
+    else
+        noScenes++;
+
+    cachedScene &s = scenes[slot];
+    s.key = key;
+    s.arena = sceneArena;
+    s.bvh = bvh;
+    s.noObjects = noObjects;
+    s.objects = objects;
+    s.noLights = noLights;
+    s.lights = lights;
+    s.camera = camera;
+    s.visualizationType = visualizationType;
+    s.fadingCoeficient = fadingCoeficient;
+    s.fullLightLimit = fullLightLimit;
+    s.lastUse = ++clock;
+}
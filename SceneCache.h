@@ -0,0 +1,61 @@
+#ifndef _H_SceneCache
+#define _H_SceneCache
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Object.h"
+#include "Light.h"
+#include "Arena.h"
+#include "BVH.h"
+
+/* A scene kept ready to be traced: its objects, its lights with their
+ * occluders, the arena they were made in, its tree of boxes, and what else
+ * the scene sets.
+ */
+struct cachedScene
+{
+    unsigned long long key;
+    Arena *arena;
+    BVH *bvh;
+    int noObjects;
+    Object **objects;
+    int noLights;
+    Light *lights;
+    point camera;
+    int visualizationType;
+    long long fadingCoeficient, fullLightLimit;
+    /* When it was last traced. */
+    long long lastUse;
+};
+
+/* Header for the SceneCache class. It keeps the last scenes traced, each
+ * under a number made from what it holds, so one asked for again is traced
+ * at once, without being built again. When it is full, the scene not
+ * traced for the longest time is freed.
+ */
+class SceneCache
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int capacity;
+    int noScenes;
+    cachedScene *scenes;
+    long long clock;
+
+    void freeScene(cachedScene &s);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit SceneCache(int capacity);
+    ~SceneCache();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Makes the scene kept under key the one traced. Returns false if there
+     * is none.
+     */
+    bool use(unsigned long long key);
+    /* Keeps the scene being traced under key. */
+    void keep(unsigned long long key);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "Socket.h"
+
+/* The sockets of the system are kept as numbers, -1 when not valid. */
+#ifdef _WIN32
+#define toHandle(s) ((s) == INVALID_SOCKET ? -1 : (long long) (s))
+#define closeHandle(h) closesocket((SOCKET) (h))
+#else
+#define toHandle(s) ((long long) (s))
+#define closeHandle(h) ::close((int) (h))
+#endif
+
+/* A lost connection must not end the process. */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Constructor. */
+Socket::Socket(): handle(-1) { }
+
+/* Destructor. */
+Socket::~Socket()
+{
+    close();
+}
+
+/* Windows needs its sockets to be started once. */
+bool Socket::startup()
+{
+#ifdef _WIN32
+    static bool started = false;
+    WSADATA data;
+
+    if (!started)
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+
+    return started;
+#else
+    return true;
+#endif
+}
+
+/* With no address, AI_PASSIVE gives the one of every interface. */
+bool Socket::listen(const char *address, int port)
+{
+    struct addrinfo hints, *found;
+    char service[16];
+    int yes = 1;
+
+    if (!startup())
+        return false;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    sprintf(service, "%d", port);
+
+    if (getaddrinfo(address, service, &hints, &found) != 0)
+        return false;
+
+    handle = toHandle(socket(found->ai_family, found->ai_socktype, found->ai_protocol));
+    if (handle >= 0)
+    {
+        setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char *) &yes, sizeof(yes));
+        if (bind(handle, found->ai_addr, found->ai_addrlen) != 0 || ::listen(handle, 16) != 0)
+            close();
+    }
+
+    freeaddrinfo(found);
+
+    return handle >= 0;
+}
+
+Socket *Socket::accept()
+{
+    long long h = toHandle(::accept(handle, NULL, NULL));
+    int yes = 1;
+
+    if (h < 0)
+        return NULL;
+
+    /* The messages are small, and each one is waited for. */
+    setsockopt(h, IPPROTO_TCP, TCP_NODELAY, (const char *) &yes, sizeof(yes));
+
+    Socket *s = new Socket();
+    s->handle = h;
+    return s;
+}
+
+bool Socket::connect(const char *host, int port)
+{
+    struct addrinfo hints, *found, *a;
+    char service[16];
+    int yes = 1;
+
+    if (!startup())
+        return false;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    sprintf(service, "%d", port);
+
+    if (getaddrinfo(host, service, &hints, &found) != 0)
+        return false;
+
+    /* The first address that answers. */
+    for (a = found; a != NULL; a = a->ai_next)
+    {
+        handle = toHandle(socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+        if (handle < 0)
+            continue;
+
+        if (::connect(handle, a->ai_addr, a->ai_addrlen) == 0)
+            break;
+
+        close();
+    }
+
+    freeaddrinfo(found);
+
+    if (handle < 0)
+        return false;
+
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *) &yes, sizeof(yes));
+    return true;
+}
+
+bool Socket::send(const void *data, int size)
+{
+    const char *bytes = (const char *) data;
+
+    while (size > 0)
+    {
+        int sent = ::send(handle, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+
+        bytes += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+bool Socket::receive(void *data, int size)
+{
+    char *bytes = (char *) data;
+
+    while (size > 0)
+    {
+        int received = recv(handle, bytes, size, 0);
+        if (received <= 0)
+            return false;
+
+        bytes += received;
+        size -= received;
+    }
+
+    return true;
+}
+
+void Socket::close()
+{
+    if (handle >= 0)
+        closeHandle(handle);
+
+    handle = -1;
+}
@@ -0,0 +1,41 @@
+#ifndef _H_Socket
+#define _H_Socket
+
+/* Header for the Socket class. It is a TCP connection between two
+ * processes, which may be on different machines, or one that waits for
+ * them to connect.
+ */
+class Socket
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    /* The socket of the system, or -1. */
+    long long handle;
+
+    static bool startup();
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Socket();
+    ~Socket();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Waits for connections on a port of this machine, at one of its
+     * addresses, such as "127.0.0.1" for itself only, or at all of them if
+     * address is NULL.
+     */
+    bool listen(const char *address, int port);
+    /* Waits for the next connection, and returns it, or NULL. */
+    Socket *accept();
+    /* Connects to a port of a machine, by its name or address. */
+    bool connect(const char *host, int port);
+
+    /* Sends or receives exactly size bytes. Returns false if the connection
+     * is lost.
+     */
+    bool send(const void *data, int size);
+    bool receive(void *data, int size);
+    void close();
+};
+
+#endif
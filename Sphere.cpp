@@ -3,6 +3,7 @@
 #include "Sphere.h"
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
 
 /* In the constructor, we set the starting point of the ray. */
 Sphere::Sphere(double x, double y, double z, double rad, double rC, double gC, double bC):
@@ -167,5 +168,32 @@ void Sphere::intersectionPointNormal(Ray &ray, vector &normalInt)
     return;
 }
 
+/* The box that encloses the sphere. */
+bool Sphere::getBounds(point &lower, point &upper)
+{
+    lower.x = centre.x - radius;
+    lower.y = centre.y - radius;
+    lower.z = centre.z - radius;
+    upper.x = centre.x + radius;
+    upper.y = centre.y + radius;
+    upper.z = centre.z + radius;
+
+    return true;
+}
+
+int Sphere::getType() { return OBJECT_SPHERE; }
+
+void Sphere::pack(Message &m)
+{
+    Object::pack(m);
+    m.putDouble(radius);
+}
+
+void Sphere::unpack(Message &m)
+{
+    Object::unpack(m);
+    radius = m.getDouble();
+}
+
 /* Returns the radius of the sphere. */
 double Sphere::getRadius() { return radius; }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+/* Defines the needed classes and their headers. */
+#include "ThreadPool.h"
+
+/* The node of each thread of the pool. */
+static __thread int currentNode = 0;
+
+/* Constructor. */
+Future::Future(ThreadPool *pool, taskFunction function, void *argument):
+    function(function),
+    argument(argument),
+    result(NULL),
+    done(false),
+    pool(pool),
+    next(NULL)
+{ }
+
+/* Destructor. */
+Future::~Future() { }
+
+void *Future::wait()
+{
+    pthread_mutex_lock(&pool->mutex);
+    while (!done)
+        pthread_cond_wait(&pool->finished, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return result;
+}
+
+bool Future::isDone()
+{
+    pthread_mutex_lock(&pool->mutex);
+    bool d = done;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return d;
+}
+
+/* In the constructor, the threads are made, and wait for tasks. */
+ThreadPool::ThreadPool(int noThreads, bool pinned):
+    noThreads(noThreads < 1 ? 1 : noThreads),
+    pinned(pinned),
+    first(NULL),
+    last(NULL),
+    stopping(false),
+    started(0)
+{
+    int i;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&available, NULL);
+    pthread_cond_init(&finished, NULL);
+
+    threads = new pthread_t[this->noThreads];
+    for (i = 0; i < this->noThreads; i++)
+        pthread_create(&threads[i], NULL, run, this);
+}
+
+/* Destructor. The threads end once the tasks given are done. */
+ThreadPool::~ThreadPool()
+{
+    int i;
+
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&available);
+    pthread_mutex_unlock(&mutex);
+
+    for (i = 0; i < noThreads; i++)
+        pthread_join(threads[i], NULL);
+
+    delete [] threads;
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&available);
+    pthread_cond_destroy(&finished);
+}
+
+int ThreadPool::getNoProcessors()
+{
+    NumaTopology t;
+    return t.getNoProcessors();
+}
+
+/* Keeps the calling thread on one processor. */
+void ThreadPool::pin(int thread)
+{
+    if (!pinned || noThreads > topology.getNoProcessors())
+        return;
+
+    int processor = topology.placeThread(thread);
+    currentNode = topology.getNode(processor);
+
+#ifdef _WIN32
+    if (processor < 64)
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << processor);
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(processor, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+/* Each thread takes the oldest task, runs it, and waits for another. */
+void *ThreadPool::run(void *pool)
+{
+    ThreadPool *p = (ThreadPool *) pool;
+
+    pthread_mutex_lock(&p->mutex);
+    int thread = p->started++;
+    pthread_mutex_unlock(&p->mutex);
+
+    p->pin(thread);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&p->mutex);
+        while (p->first == NULL && !p->stopping)
+            pthread_cond_wait(&p->available, &p->mutex);
+
+        if (p->first == NULL)
+        {
+            pthread_mutex_unlock(&p->mutex);
+            return NULL;
+        }
+
+        Future *f = p->first;
+        p->first = f->next;
+        if (p->first == NULL)
+            p->last = NULL;
+        pthread_mutex_unlock(&p->mutex);
+
+        void *result = f->function(f->argument);
+
+        pthread_mutex_lock(&p->mutex);
+        f->result = result;
+        f->done = true;
+        pthread_cond_broadcast(&p->finished);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+Future *ThreadPool::submit(taskFunction function, void *argument)
+{
+    Future *f = new Future(this, function, argument);
+
+    pthread_mutex_lock(&mutex);
+    if (last == NULL)
+        first = f;
+    else
+        last->next = f;
+    last = f;
+    pthread_cond_signal(&available);
+    pthread_mutex_unlock(&mutex);
+
+    return f;
+}
+
+int ThreadPool::getCurrentNode() { return currentNode; }
+
+void ThreadPool::yield()
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+int ThreadPool::getNoThreads() { return noThreads; }
+
+int ThreadPool::getNoNodes()
+{
+    return pinned && noThreads <= topology.getNoProcessors() ? topology.getNoNodes() : 1;
+}
@@ -0,0 +1,99 @@
+#ifndef _H_ThreadPool
+#define _H_ThreadPool
+
+/* Needed libraries. */
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "NumaTopology.h"
+
+/* A task: a function and the argument it is called with. */
+typedef void *(*taskFunction)(void *argument);
+
+class ThreadPool;
+
+/* Header for the Future class. It is a task given to a ThreadPool, which
+ * tells when the task is done and what it returned.
+ */
+class Future
+{
+    friend class ThreadPool;
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    taskFunction function;
+    void *argument;
+    void *result;
+    bool done;
+    ThreadPool *pool;
+    /* The next task waiting in the pool. */
+    Future *next;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit Future(ThreadPool *pool, taskFunction function, void *argument);
+    ~Future();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Waits until the task is done, and gives what it returned. */
+    void *wait();
+    bool isDone();
+};
+
+/* Header for the ThreadPool class. Its threads are made once and stay
+ * alive, waiting for tasks, so tracing many images, or serving many jobs,
+ * doesn't make new threads each time. Each thread may be kept on its own
+ * processor, so its caches stay warm. Then, the threads are spread among
+ * the nodes of the machine, and each one knows its node.
+ */
+class ThreadPool
+{
+    friend class Future;
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int noThreads;
+    pthread_t *threads;
+    bool pinned;
+    NumaTopology topology;
+
+    /* The tasks not yet taken, oldest first, and if the threads must end. */
+    Future *first, *last;
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t available, finished;
+
+    /* The next thread to start, which tells each one its number. */
+    int started;
+
+    static void *run(void *pool);
+    void pin(int thread);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. With pinned, each thread only runs on its
+     * own processor, if there are enough of them.
+     */
+    explicit ThreadPool(int noThreads, bool pinned);
+    ~ThreadPool();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Gives a task to the first thread free. The future is deleted by whoever
+     * submits it, once done.
+     */
+    Future *submit(taskFunction function, void *argument);
+
+    /* How many processors this machine has. */
+    static int getNoProcessors();
+
+    /* The node of the thread of the pool calling it, or 0 for any other. */
+    static int getCurrentNode();
+
+    /* Gives the processor to another thread, for one that waits on another. */
+    static void yield();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getNoThreads();
+    /* The nodes the threads are on: 1 if they aren't kept on a processor. */
+    int getNoNodes();
+};
+
+#endif
@@ -0,0 +1,91 @@
+/* Defines the needed classes and their headers. */
+#include "TileQueue.h"
+
+/* In the constructor, slot i is free for the turn i. */
+TileQueue::TileQueue(int capacity):
+    capacity(capacity < 1 ? 1 : capacity),
+    tail(0),
+    head(0),
+    sleeping(0)
+{
+    int i;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&pushed, NULL);
+
+    tiles = new tile[this->capacity];
+    sequences = new long[this->capacity];
+
+    for (i = 0; i < this->capacity; i++)
+        sequences[i] = i;
+}
+
+/* Destructor. */
+TileQueue::~TileQueue()
+{
+    delete [] tiles;
+    delete [] sequences;
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&pushed);
+}
+
+void TileQueue::push(tile t)
+{
+    /* Each thread gets its own turn, and so its own slot. */
+    long turn = __sync_fetch_and_add(&tail, 1);
+    int slot = turn % capacity;
+
+    /* The slot may still hold the tile of the previous lap. */
+    while (sequences[slot] != turn)
+        __sync_synchronize();
+
+    tiles[slot] = t;
+
+    /* The tile must be written before the slot is seen as full. */
+    __sync_synchronize();
+    sequences[slot] = turn + 1;
+
+    /* The taker says it sleeps before it looks at the slot a last time, so
+     * either it sees the tile or we see it sleeping.
+     */
+    __sync_synchronize();
+    if (sleeping)
+    {
+        pthread_mutex_lock(&mutex);
+        pthread_cond_signal(&pushed);
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+bool TileQueue::pop(tile &t)
+{
+    int slot = head % capacity;
+
+    if (sequences[slot] != head + 1)
+        return false;
+
+    /* The slot is only read after it is seen as full. */
+    __sync_synchronize();
+    t = tiles[slot];
+
+    /* And only given back once read, for the next lap. */
+    __sync_synchronize();
+    sequences[slot] = head + capacity;
+    head++;
+
+    return true;
+}
+
+void TileQueue::take(tile &t)
+{
+    while (!pop(t))
+    {
+        pthread_mutex_lock(&mutex);
+        sleeping = 1;
+        __sync_synchronize();
+        if (sequences[head % capacity] != head + 1)
+            pthread_cond_wait(&pushed, &mutex);
+        sleeping = 0;
+        pthread_mutex_unlock(&mutex);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef _H_TileQueue
+#define _H_TileQueue
+
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+
+/* A rectangle of the image, traced as a whole by one thread. */
+struct tile
+{
+    int x, y;
+    int width, height;
+};
+
+/* Header for the TileQueue class. The threads that trace the image push
+ * the tiles they finish, and the window takes them out to show them. Many
+ * threads may push at the same time, but only one may take. Neither waits
+ * for a lock: each slot has a sequence number that tells whether it is
+ * free, or full, for the turn of whoever looks at it. Only a taker with
+ * nothing else to do sleeps, and the pushers wake it.
+ */
+class TileQueue
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    int capacity;
+    tile *tiles;
+    volatile long *sequences;
+    /* The next turn to push and the next one to take. */
+    volatile long tail;
+    long head;
+    /* If the taker sleeps until a tile is pushed. */
+    volatile int sleeping;
+    pthread_mutex_t mutex;
+    pthread_cond_t pushed;
+
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit TileQueue(int capacity);
+    ~TileQueue();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Adds a tile. If the queue is full, waits for a slot to be taken. */
+    void push(tile t);
+    /* Takes the oldest tile. Returns false if there's none. */
+    bool pop(tile &t);
+    /* Takes the oldest tile, sleeping until there is one. */
+    void take(tile &t);
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines the needed classes and their headers. */
+#include "TiledImage.h"
+
+#define TILED_VERSION 1
+
+/* The numbers of the file take 4 bytes, the lowest first. */
+static void putInt(unsigned char *out, int value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static int getInt(unsigned char *in)
+{
+    return in[0] | in[1] << 8 | in[2] << 16 | in[3] << 24;
+}
+
+/* Constructor. */
+TiledImage::TiledImage(const char *fileName):
+    file(NULL),
+    width(0),
+    height(0),
+    pixelsExpected(0),
+    pixelsWritten(0),
+    noTiles(0),
+    records(NULL)
+{
+    this->fileName = new char[strlen(fileName) + 1];
+    strcpy(this->fileName, fileName);
+    pthread_mutex_init(&mutex, NULL);
+}
+
+/* Destructor. */
+TiledImage::~TiledImage()
+{
+    if (file != NULL)
+        fclose(file);
+
+    delete [] fileName;
+    delete [] records;
+    pthread_mutex_destroy(&mutex);
+}
+
+/* The files may be larger than what a long can reach. */
+bool TiledImage::seek(long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+bool TiledImage::create(int width, int height, long long noPixels)
+{
+    unsigned char header[16];
+
+    file = fopen(fileName, "wb");
+    if (file == NULL)
+        return false;
+
+    this->width = width;
+    this->height = height;
+    pixelsExpected = noPixels;
+
+    memcpy(header, "RTTL", 4);
+    putInt(header + 4, TILED_VERSION);
+    putInt(header + 8, width);
+    putInt(header + 12, height);
+    fwrite(header, 1, 16, file);
+
+    return true;
+}
+
+void TiledImage::writeTile(tile t, unsigned char *pixels)
+{
+    unsigned char header[16];
+
+    putInt(header, t.x);
+    putInt(header + 4, t.y);
+    putInt(header + 8, t.width);
+    putInt(header + 12, t.height);
+
+    /* The tile must not be split by another one. */
+    pthread_mutex_lock(&mutex);
+
+    fwrite(header, 1, 16, file);
+    fwrite(pixels, 1, t.width * t.height * 3, file);
+
+    pixelsWritten += t.width * t.height;
+    if (pixelsWritten == pixelsExpected)
+    {
+        close();
+        printf("Image written to %s.\n", fileName);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+void TiledImage::close()
+{
+    if (file != NULL)
+        fclose(file);
+
+    file = NULL;
+}
+
+bool TiledImage::load()
+{
+    unsigned char header[16];
+    long long offset = 16;
+    int capacity = 1024;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL)
+        return false;
+
+    if (fread(header, 1, 16, file) != 16 || memcmp(header, "RTTL", 4) != 0 ||
+            getInt(header + 4) != TILED_VERSION)
+        return false;
+
+    width = getInt(header + 8);
+    height = getInt(header + 12);
+
+    /* Goes from tile to tile, only reading where each one is. */
+    records = new tileRecord[capacity];
+
+    while (fread(header, 1, 16, file) == 16)
+    {
+        tileRecord r;
+        r.t.x = getInt(header);
+        r.t.y = getInt(header + 4);
+        r.t.width = getInt(header + 8);
+        r.t.height = getInt(header + 12);
+        r.offset = offset + 16;
+
+        if (r.t.x < 0 || r.t.y < 0 || r.t.width < 0 || r.t.height < 0 ||
+                r.t.x + r.t.width > width || r.t.y + r.t.height > height)
+            return false;
+
+        if (noTiles == capacity)
+        {
+            tileRecord *more = new tileRecord[capacity * 2];
+            memcpy(more, records, capacity * sizeof(tileRecord));
+            delete [] records;
+            records = more;
+            capacity *= 2;
+        }
+        records[noTiles++] = r;
+
+        offset = r.offset + (long long) r.t.width * r.t.height * 3;
+        if (!seek(offset))
+            return false;
+    }
+
+    return true;
+}
+
+bool TiledImage::readRows(int i, int first, int count, unsigned char *out, int stride)
+{
+    int row;
+    tile t = records[i].t;
+
+    if (!seek(records[i].offset + (long long) first * t.width * 3))
+        return false;
+
+    for (row = 0; row < count; row++)
+        if (fread(out + row * stride, 1, t.width * 3, file) != (size_t) (t.width * 3))
+            return false;
+
+    return true;
+}
+
+int TiledImage::getWidth() { return width; }
+int TiledImage::getHeight() { return height; }
+int TiledImage::getNoTiles() { return noTiles; }
+tile TiledImage::getTile(int i) { return records[i].t; }
@@ -0,0 +1,77 @@
+#ifndef _H_TiledImage
+#define _H_TiledImage
+
+/* Needed libraries. */
+#include <stdio.h>
+#include <pthread.h>
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "TileQueue.h"
+
+/* A tile kept in a tiled file, and where its pixels start. */
+struct tileRecord
+{
+    tile t;
+    long long offset;
+};
+
+/* Header for the TiledImage class. It is a file to which the threads add
+ * their tiles as soon as they finish them, in any order, so only the
+ * tiles being traced are ever in memory. Each tile says where it goes in
+ * the image. The file starts with "RTTL", its version, and the width and
+ * height of the image; then, for each tile, its x, y, width and height,
+ * and its pixels, one row after the other from the bottom, in RGB. All the
+ * numbers take 4 bytes, the lowest first.
+ */
+class TiledImage
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    char *fileName;
+    FILE *file;
+    int width, height;
+
+    /* While writing: how many pixels are expected and how many are in the
+     * file. The file is closed by the thread that writes the last ones.
+     */
+    long long pixelsExpected, pixelsWritten;
+    pthread_mutex_t mutex;
+
+    /* While reading: the tiles found in the file. */
+    int noTiles;
+    tileRecord *records;
+
+    bool seek(long long offset);
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. */
+    explicit TiledImage(const char *fileName);
+    ~TiledImage();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Makes the file for an image of the given size, of which noPixels
+     * are to be traced. Returns false on failure.
+     */
+    bool create(int width, int height, long long noPixels);
+    /* Adds a tile, with its pixels as RGB. Many threads may call it. */
+    void writeTile(tile t, unsigned char *pixels);
+    void close();
+
+    /* Reads the header and finds all the tiles of the file. Returns false
+     * if it isn't a tiled file.
+     */
+    bool load();
+    /* Reads count rows of the tile i, from its row first, each to its own
+     * place in out, stride bytes apart.
+     */
+    bool readRows(int i, int first, int count, unsigned char *out, int stride);
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    int getWidth();
+    int getHeight();
+    int getNoTiles();
+    tile getTile(int i);
+};
+
+#endif
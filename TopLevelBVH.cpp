@@ -0,0 +1,396 @@
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+
+/* Defines the needed classes and their headers. */
+#include "TopLevelBVH.h"
+#include "PerfCounter.h"
+
+using namespace std;
+
+/* Orders the instances by the centres of their boxes along an axis. */
+struct instanceOrder
+{
+    int axis;
+
+    bool operator () (const tlasInstance &a, const tlasInstance &b) const
+    {
+        return a.box.lower[axis] + a.box.upper[axis] < b.box.lower[axis] + b.box.upper[axis];
+    }
+};
+
+/* Constructor. */
+TopLevelBVH::TopLevelBVH(int method, int width, bool compressed):
+    noInstances(0),
+    instances(NULL),
+    noNodes(0),
+    nodes(NULL),
+    noUnbounded(0),
+    unbounded(NULL),
+    buildTime(0),
+    updateTime(0)
+{
+    staticTree = new BVH(method, width, compressed, false);
+}
+
+/* Destructor. */
+TopLevelBVH::~TopLevelBVH()
+{
+    release();
+    delete staticTree;
+}
+
+void TopLevelBVH::release()
+{
+    delete [] instances;
+    delete [] nodes;
+    delete [] unbounded;
+
+    instances = NULL;
+    nodes = NULL;
+    unbounded = NULL;
+    noInstances = 0;
+    noNodes = 0;
+    noUnbounded = 0;
+}
+
+/* Builds the node over count instances from first, and the ones below it,
+ * by splitting them in two halves along the axis their centres spread the
+ * most. There are few instances, so this is enough. Returns the node.
+ */
+int TopLevelBVH::split(int first, int count)
+{
+    int node = noNodes++;
+    int i, k;
+    float centreLower[3], centreUpper[3];
+
+    for (k = 0; k < 3; k++)
+    {
+        nodes[node].lower[k] = FLT_MAX;
+        nodes[node].upper[k] = -FLT_MAX;
+        centreLower[k] = FLT_MAX;
+        centreUpper[k] = -FLT_MAX;
+    }
+
+    for (i = first; i < first + count; i++)
+        for (k = 0; k < 3; k++)
+        {
+            const bvhBox &box = instances[i].box;
+            nodes[node].lower[k] = min(nodes[node].lower[k], box.lower[k]);
+            nodes[node].upper[k] = max(nodes[node].upper[k], box.upper[k]);
+            centreLower[k] = min(centreLower[k], box.lower[k] + box.upper[k]);
+            centreUpper[k] = max(centreUpper[k], box.lower[k] + box.upper[k]);
+        }
+
+    if (count == 1)
+    {
+        nodes[node].count = 1;
+        nodes[node].offset = first;
+        return node;
+    }
+
+    instanceOrder order;
+    order.axis = 0;
+    for (k = 1; k < 3; k++)
+        if (centreUpper[k] - centreLower[k] > centreUpper[order.axis] - centreLower[order.axis])
+            order.axis = k;
+
+    int half = count / 2;
+    nth_element(instances + first, instances + first + half, instances + first + count, order);
+
+    /* The first child follows its node. */
+    nodes[node].count = 0;
+    split(first, half);
+    nodes[node].offset = split(first + half, count - half);
+
+    return node;
+}
+
+void TopLevelBVH::build(Object **objects, int noObjects, const int *moving, int noMoving, ThreadPool *pool)
+{
+    double start = PerfCounter::now();
+    int i, noMembers = 0;
+    bvhBox box;
+
+    release();
+
+    bool *moves = new bool[noObjects];
+    for (i = 0; i < noObjects; i++)
+        moves[i] = false;
+    for (i = 0; i < noMoving; i++)
+        moves[moving[i]] = true;
+
+    /* The objects that move, and the planes, are kept out of the bottom
+     * level.
+     */
+    int *members = new int[noObjects];
+    instances = new tlasInstance[noMoving + 1];
+    unbounded = new int[noObjects];
+    for (i = 0; i < noObjects; i++)
+    {
+        if (!BVH::boxOf(objects[i], box, NULL))
+            unbounded[noUnbounded++] = i;
+        else if (moves[i])
+        {
+            instances[noInstances].box = box;
+            instances[noInstances].tree = NULL;
+            instances[noInstances++].object = i;
+        }
+        else
+            members[noMembers++] = i;
+    }
+
+    staticTree->build(objects, members, noMembers, pool);
+    if (staticTree->getBounds(box))
+    {
+        instances[noInstances].box = box;
+        instances[noInstances].tree = staticTree;
+        instances[noInstances++].object = -1;
+    }
+
+    delete [] moves;
+    delete [] members;
+
+    nodes = new bvhNode[2 * noInstances + 1];
+    if (noInstances > 0)
+        split(0, noInstances);
+
+    buildTime = PerfCounter::now() - start;
+}
+
+/* An object that lost its box keeps the last one it had. */
+void TopLevelBVH::update(Object **objects)
+{
+    double start = PerfCounter::now();
+    int i;
+
+    for (i = 0; i < noInstances; i++)
+        if (instances[i].tree == NULL)
+            BVH::boxOf(objects[instances[i].object], instances[i].box, NULL);
+
+    noNodes = 0;
+    if (noInstances > 0)
+        split(0, noInstances);
+
+    updateTime = PerfCounter::now() - start;
+}
+
+/* The instances are visited as the nodes of a BVH are, the nearest first,
+ * and the tree of an instance goes on from the closest hit so far.
+ */
+int TopLevelBVH::closest(Ray &ray, Object **objects, double &minT0, double &minT1)
+{
+    int i, index = -1;
+    double t0, t1;
+
+    minT0 = -1;
+    minT1 = -1;
+
+    for (i = 0; i < noUnbounded; i++)
+        if (objects[unbounded[i]]->intersects(ray, t0, t1) && (index == -1 || t0 < minT0))
+        {
+            minT0 = t0;
+            minT1 = t1;
+            index = unbounded[i];
+        }
+
+    if (noNodes == 0)
+        return index;
+
+    point o = ray.getOrigin();
+    vector d = ray.getDir();
+    float origin[3] = {(float) o.x, (float) o.y, (float) o.z};
+    float inverse[3] = {inverseOf(d.x), inverseOf(d.y), inverseOf(d.z)};
+    float limit = index == -1 ? FLT_MAX : (float) (minT0 * 1.00001);
+
+    int stack[BVH_STACK_SIZE];
+    float stackEntry[BVH_STACK_SIZE];
+    int noStacked = 0;
+    float entry, entry2;
+    int node = 0;
+
+    if (!enterBox(nodes[0], origin, inverse, limit, entry))
+        return index;
+
+    for (;;)
+    {
+        const bvhNode &n = nodes[node];
+
+        if (n.count > 0)
+        {
+            const tlasInstance &instance = instances[n.offset];
+
+            if (instance.tree != NULL)
+                index = instance.tree->closer(ray, objects, index, minT0, minT1);
+            else if (objects[instance.object]->intersects(ray, t0, t1) &&
+                     (index == -1 || t0 < minT0 || (t0 == minT0 && instance.object < index)))
+            {
+                minT0 = t0;
+                minT1 = t1;
+                index = instance.object;
+            }
+
+            if (index != -1)
+                limit = (float) (minT0 * 1.00001);
+        }
+        else
+        {
+            int first = node + 1, second = n.offset;
+            bool hitFirst = enterBox(nodes[first], origin, inverse, limit, entry);
+            bool hitSecond = enterBox(nodes[second], origin, inverse, limit, entry2);
+
+            if (hitFirst && hitSecond)
+            {
+                if (entry2 < entry)
+                {
+                    swap(first, second);
+                    swap(entry, entry2);
+                }
+                stack[noStacked] = second;
+                stackEntry[noStacked++] = entry2;
+                node = first;
+                continue;
+            }
+            if (hitFirst || hitSecond)
+            {
+                node = hitFirst ? first : second;
+                continue;
+            }
+        }
+
+        do
+        {
+            if (noStacked == 0)
+                return index;
+            noStacked--;
+        } while (stackEntry[noStacked] > limit);
+
+        node = stack[noStacked];
+    }
+}
+
+/* Any object that blocks the shadow ray ends the walk, so the order of the
+ * nodes doesn't matter, and none beyond the light is entered.
+ */
+bool TopLevelBVH::occluded(Ray &ray, Object **objects, bvhShadow &shadow)
+{
+    int i;
+
+    for (i = 0; i < noUnbounded; i++)
+        if (dimShadow(shadow, objects[unbounded[i]], unbounded[i], ray))
+            return true;
+
+    if (noNodes == 0)
+        return false;
+
+    point o = ray.getOrigin();
+    vector d = ray.getDir();
+    float origin[3] = {(float) o.x, (float) o.y, (float) o.z};
+    float inverse[3] = {inverseOf(d.x), inverseOf(d.y), inverseOf(d.z)};
+    float limit = (float) (shadow.distance * 1.00001);
+
+    int stack[BVH_STACK_SIZE];
+    int noStacked = 0;
+    float entry;
+
+    if (enterBox(nodes[0], origin, inverse, limit, entry))
+        stack[noStacked++] = 0;
+
+    while (noStacked > 0)
+    {
+        int node = stack[--noStacked];
+        const bvhNode &n = nodes[node];
+
+        if (n.count > 0)
+        {
+            const tlasInstance &instance = instances[n.offset];
+
+            if (instance.tree != NULL ? instance.tree->occludedByBoxes(ray, objects, shadow) :
+                    dimShadow(shadow, objects[instance.object], instance.object, ray))
+                return true;
+            continue;
+        }
+
+        if (enterBox(nodes[n.offset], origin, inverse, limit, entry))
+            stack[noStacked++] = n.offset;
+        if (enterBox(nodes[node + 1], origin, inverse, limit, entry))
+            stack[noStacked++] = node + 1;
+    }
+
+    return false;
+}
+
+/* The box of a leaf is the box of its instance, so an object that moves is
+ * visited as soon as the query enters its leaf.
+ */
+bool TopLevelBVH::search(bvhQuery &query, bool build)
+{
+    int stack[BVH_STACK_SIZE];
+    int noStacked = 0;
+
+    if (noNodes > 0)
+        stack[noStacked++] = 0;
+
+    while (noStacked > 0)
+    {
+        int node = stack[--noStacked];
+        const bvhNode &n = nodes[node];
+
+        if (!query.enters(n.lower, n.upper))
+            continue;
+
+        if (n.count > 0)
+        {
+            const tlasInstance &instance = instances[n.offset];
+
+            if (instance.tree != NULL ? instance.tree->search(query, build) : query.visit(instance.object))
+                return true;
+            continue;
+        }
+
+        stack[noStacked++] = n.offset;
+        stack[noStacked++] = node + 1;
+    }
+
+    return false;
+}
+
+/* The top level is small, so it is copied with the tree of the objects
+ * that don't move, and its instance is the copy of that tree.
+ */
+TopLevelBVH *TopLevelBVH::replicate()
+{
+    int i;
+    BVH *tree = staticTree->replicate();
+
+    if (tree == NULL)
+        return NULL;
+
+    TopLevelBVH *copy = new TopLevelBVH(staticTree->getMethod(), staticTree->getWidth(), staticTree->isCompressed());
+    delete copy->staticTree;
+    copy->staticTree = tree;
+
+    copy->noInstances = noInstances;
+    copy->instances = new tlasInstance[noInstances + 1];
+    for (i = 0; i < noInstances; i++)
+    {
+        copy->instances[i] = instances[i];
+        if (instances[i].tree != NULL)
+            copy->instances[i].tree = tree;
+    }
+    copy->noNodes = noNodes;
+    copy->nodes = new bvhNode[2 * noInstances + 1];
+    memcpy(copy->nodes, nodes, noNodes * sizeof(bvhNode));
+    copy->noUnbounded = noUnbounded;
+    copy->unbounded = new int[noUnbounded];
+    memcpy(copy->unbounded, unbounded, noUnbounded * sizeof(int));
+    copy->buildTime = buildTime;
+    copy->updateTime = updateTime;
+
+    return copy;
+}
+
+BVH *TopLevelBVH::getStaticTree() { return staticTree; }
+int TopLevelBVH::getNoInstances() { return noInstances; }
+double TopLevelBVH::getBuildTime() { return buildTime; }
+double TopLevelBVH::getUpdateTime() { return updateTime; }
@@ -0,0 +1,88 @@
+#ifndef _H_TopLevelBVH
+#define _H_TopLevelBVH
+
+/* Defines the needed classes and their headers. */
+#include "BasicStructures.h"
+#include "Object.h"
+#include "Ray.h"
+#include "BVH.h"
+#include "ThreadPool.h"
+
+/* What the top level is built over: the tree of the objects that don't
+ * move, or else one object that does, with its box.
+ */
+struct tlasInstance
+{
+    bvhBox box;
+    BVH *tree;
+    int object;
+};
+
+/* Header for the TopLevelBVH class. It is a tree of boxes over instances,
+ * for scenes where a few objects move among many that don't. The objects
+ * that don't move are kept in a tree of their own, a bottom level built
+ * once, and each object that moves is an instance by itself. So only the
+ * small tree over the instances is built again for each frame. The planes
+ * have no box, so they stay out of both levels and every ray tries them.
+ */
+class TopLevelBVH
+{
+private:
+    /* - - - - - - - - - - - - ATTRIBUTES - - - - - - - - - -*/
+    BVH *staticTree;
+
+    /* The instances, in the order of the leaves, and the nodes over them,
+     * the root first. Each leaf holds one instance.
+     */
+    int noInstances;
+    tlasInstance *instances;
+    int noNodes;
+    bvhNode *nodes;
+
+    /* The objects with no box. */
+    int noUnbounded;
+    int *unbounded;
+
+    double buildTime, updateTime;
+
+    int split(int first, int count);
+    void release();
+public:
+    /* - - - - - - - CONSTRUCTOR & DESTRUCTOR - - - - - - - -*/
+    /* Constructor & destructor. The tree of the objects that don't move is
+     * built as a BVH of the same method, width and compression.
+     */
+    explicit TopLevelBVH(int method, int width, bool compressed);
+    ~TopLevelBVH();
+
+    /* - - - - - - - OTHER METHODS - - - - - - - -*/
+    /* Builds both levels, given the objects that will move. */
+    void build(Object **objects, int noObjects, const int *moving, int noMoving, ThreadPool *pool);
+    /* Builds the top level again, after the objects that move did. */
+    void update(Object **objects);
+
+    /* Finds the closest object hit by the ray, or -1 if there is none, as
+     * a single BVH would.
+     */
+    int closest(Ray &ray, Object **objects, double &minT0, double &minT1);
+    /* Dims the shadow ray by the objects it goes through, as
+     * BVH::occluded() does.
+     */
+    bool occluded(Ray &ray, Object **objects, bvhShadow &shadow);
+    /* Searches the boxes of both levels, as BVH::search() does. */
+    bool search(bvhQuery &query, bool build);
+
+    /* A copy of both levels, as BVH::replicate() makes one. Returns NULL if
+     * the tree of the objects that don't move is lazy.
+     */
+    TopLevelBVH *replicate();
+
+    /* - - - - - - - GETTERS & SETTERS - - - - - - - -*/
+    BVH *getStaticTree();
+    int getNoInstances();
+    /* In seconds, for both levels, and for the last update. */
+    double getBuildTime();
+    double getUpdateTime();
+};
+
+#endif
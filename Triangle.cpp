@@ -1,8 +1,12 @@
 /* Defines the needed classes and their headers. */
 #include <stdio.h>
+#include <algorithm>
 #include "Triangle.h"
 #include "Object.h"
 #include "Ray.h"
+#include "Message.h"
+
+using namespace std;
 
 /* In the constructor, we set the starting point of the ray. */
 Triangle::Triangle(double rC, double gC, double bC)
@@ -110,6 +114,59 @@ void Triangle::intersectionPointNormal(Ray &ray, vector &normalInt)
     return;
 }
 
+/* The box that encloses the three vertixes of the triangle. */
+bool Triangle::getBounds(point &lower, point &upper)
+{
+    int i;
+
+    lower = vertixes[0];
+    upper = vertixes[0];
+
+    for (i = 1; i < 3; i++)
+    {
+        lower.x = min(lower.x, vertixes[i].x);
+        lower.y = min(lower.y, vertixes[i].y);
+        lower.z = min(lower.z, vertixes[i].z);
+        upper.x = max(upper.x, vertixes[i].x);
+        upper.y = max(upper.y, vertixes[i].y);
+        upper.z = max(upper.z, vertixes[i].z);
+    }
+
+    return true;
+}
+
+/* The vertixes move with the triangle, and its normal stays the same. */
+void Triangle::move(vector offset)
+{
+    int i;
+
+    centre = centre + offset;
+    for (i = 0; i < 3; i++)
+        vertixes[i] = vertixes[i] + offset;
+}
+
+int Triangle::getType() { return OBJECT_TRIANGLE; }
+
+void Triangle::pack(Message &m)
+{
+    int i;
+
+    Object::pack(m);
+    m.putVector(normal);
+    for (i = 0; i < 3; i++)
+        m.putPoint(vertixes[i]);
+}
+
+void Triangle::unpack(Message &m)
+{
+    int i;
+
+    Object::unpack(m);
+    normal = m.getVector();
+    for (i = 0; i < 3; i++)
+        vertixes[i] = m.getPoint();
+}
+
 /* Returns the radius of the sphere. */
 vector Triangle::getNormal() { return normal; }
 
@@ -2,6 +2,8 @@
 #include <GL/glut.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 /* For threads. */
 #include <pthread.h>
 
@@ -12,6 +14,23 @@
 #include "Plane.h"
 #include "BasicStructures.h"
 #include "Object.h"
+#include "Sampler.h"
+#include "TileQueue.h"
+#include "OutputStage.h"
+#include "ImageWriter.h"
+#include "MappedImage.h"
+#include "TiledImage.h"
+#include "RenderRegion.h"
+#include "Message.h"
+#include "RenderMaster.h"
+#include "RenderWorker.h"
+#include "RenderServer.h"
+#include "ThreadPool.h"
+#include "HugePages.h"
+#include "Arena.h"
+#include "BVH.h"
+#include "TopLevelBVH.h"
+#include "PerfCounter.h"
 
 using namespace std;
 
@@ -20,16 +39,59 @@ int screenWidth = SCREEN_W;
 int screenHeight = SCREEN_H;
 int screenSize = SCREEN_W*SCREEN_H;
 
+/* The resolution of the final image. The screen definition above is the
+ * size of the view plane, through which the rays are cast. It may be set
+ * with -res, up to the screen definition.
+ */
+int imageWidth = SCREEN_W/2;
+int imageHeight = SCREEN_H/2;
+
 /* This array will hold all the colours for all the pixels in the screen. */
 colour image[SCREEN_W][SCREEN_H];
 
+/* The antialiasing. A pixel that stands at an edge, or whose colour differs
+ * from a neighbour by more than the threshold, is traced again with
+ * maxSamples samples, placed by the sampler. A negative threshold traces
+ * every pixel with all its samples.
+ */
+int maxSamples = 16;
+double adaptiveThreshold = 0.1;
+int samplePattern = SAMPLER_STRATIFIED;
+Sampler *sampler;
+
+/* When the rays stop. No ray bounces more than maxDepth times, unless its
+ * object says otherwise. A ray that can't change its pixel by more than
+ * minContribution, half of the step between two shades of a colour, stops
+ * too. With the russian roulette, the rays weaker than rouletteThreshold
+ * stop at random instead, which keeps the image unbiased.
+ */
+int maxDepth = MAX_DEPTH;
+double minContribution = 0.5 / 255;
+bool russianRoulette = false;
+double rouletteThreshold = 0.1;
+
+/* The most rays traced after each primary ray, the ones that may add most
+ * to the pixel first. It bounds the time a pixel full of glass can take.
+ */
+int rayBudget = 16;
+
 /* Definition of all objects in the scene, as well as the camera. */
 point camera;
 
 /* Threads variables. */
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t goOn = PTHREAD_COND_INITIALIZER;
-pthread_t *thr_array;
+
+/* The threads that trace, made once and kept for every image and job. By
+ * default, one for each processor, each kept on its own.
+ */
+int noThreads = 0;
+ThreadPool *threadPool = NULL;
+
+/* On a machine with many nodes, each one keeps its own copy of the objects
+ * and of their tree, unless there isn't memory for it.
+ */
+bool sceneReplicas = true;
 
 int noObjects;
 Object **objects;
@@ -37,6 +99,33 @@ Object **objects;
 int noLights;
 Light *lights;
 
+/* Where the objects and lights of the scene are made, so the whole scene
+ * is freed at once.
+ */
+Arena *sceneArena = NULL;
+
+/* The tree of boxes around the objects, and how it is built. With -accel
+ * none, each ray tries every object. With -binarytree, the tree is not made
+ * wide, and with -compressbvh, its nodes take less memory. With -lazybvh,
+ * only its top is built before tracing, and each subtree below when a ray
+ * first gets there, so the first pixels come sooner.
+ */
+int acceleratorType = BVH_SAH;
+bool wideTree = true;
+bool compressedTree = false;
+bool lazyTree = false;
+BVH *bvh = NULL;
+
+/* The frames traced with -frames, as the spheres move between them. Each
+ * but the last is written to a file of its own, numbered, and the last one
+ * is shown as a single image is. The spheres are kept out of the tree of
+ * the other objects, under a small tree built again for each frame; with
+ * -onelevel, a single tree follows them instead.
+ */
+int noFrames = 1;
+bool twoLevels = true;
+TopLevelBVH *topLevel = NULL;
+
 /* The visualization type. */
 int visualizationType;
 
@@ -44,68 +133,404 @@ int visualizationType;
 long long fadingCoeficient = 5000;
 long long fullLightLimit = 15000;
 
-/* Passes into an array all the colours gathered in the matrix
- * image, so we can use it in the DrawPixels.
+/* The tiles finished by the threads, waiting to be shown. */
+TileQueue *tileQueue;
+
+/* How the image becomes the 8 bit pixels of the window and of the files.
+ * A gamma of 1 shows the colours as they were traced.
+ */
+int outputFilter = FILTER_BOX;
+double exposure = 1.0;
+bool tonemap = false;
+double outputGamma = 1.0;
+OutputStage *outputStage;
+
+/* The file the image is written to, if any, as a TGA, PPM or PNG file as
+ * its extension says. It is written while the image is traced.
+ */
+char *outputFile = NULL;
+ImageWriter *imageWriter = NULL;
+
+/* Or the uncompressed TGA or PPM file the threads write into, mapped into
+ * memory. Then, the image isn't kept anywhere else, so it may be larger
+ * than the screen definition, but the window shows nothing.
+ */
+char *mappedFile = NULL;
+MappedImage *mappedImage = NULL;
+
+/* Or a tiled file, to which the threads add their tiles as they finish
+ * them. It has the same limits, and tileTool turns it into an image.
+ */
+char *tiledFile = NULL;
+TiledImage *tiledImage = NULL;
+
+/* The part of the image traced: the tiles from firstTile to lastTile, cut
+ * to a rectangle. By default, the whole image, and a negative lastTile is
+ * the last tile of the image. A part traced into a tiled
+ * file may be put together with the others by tileTool.
  */
-float *pixels = new float[(screenSize/4)*3];
+int cropX = 0, cropY = 0, cropWidth = -1, cropHeight = -1;
+int firstTile = 0, lastTile = -1;
+RenderRegion *region;
+
+/* The image may be traced by other processes, on this machine or others.
+ * The master waits for them on a port and hands out the tiles; each worker
+ * connects to it, gets the scene and traces what it is given.
+ */
+int masterPort = 0;
+RenderMaster *renderMaster = NULL;
+char *workerHost = NULL;
+int workerPort = 0;
+RenderWorker *renderWorker = NULL;
+
+/* Or the program stays running, as a server that traces the jobs sent to
+ * this port by the clients of this machine.
+ */
+int servePort = 0;
+
+/* The file a scene is written to, to be sent to a server. */
+char *sceneFile = NULL;
+
+/* The image shown in the window is kept in a texture, so only the new
+ * tiles have to be sent. Its sides are powers of two, as old versions of
+ * OpenGL need, so it may be larger than the image.
+ */
+GLuint texture;
+int textureWidth, textureHeight;
+
+/* How often, in milliseconds, the window looks for new tiles. */
+#define REFRESH_PERIOD 16
 
 void display()
 {
-    int i, j;
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    /* An antialiasing technique. Basically, we create a image four times than
-     * the final one and when generating it, we compress this bigger image into
-     * a smaller one, smoothing the differences between colours. This way, it's
-     * like each ray contributes to 25% of the final image.
-     */
-    for( i = 0; i < screenHeight/2 - 1; i++)
+    if (tileQueue == NULL)
+    {
+        glutSwapBuffers();
+        return;
+    }
+
+    /* The image covers the whole window. */
+    double s = (double) imageWidth / textureWidth;
+    double t = (double) imageHeight / textureHeight;
+
+    glBegin(GL_QUADS);
+        glTexCoord2d(0, 0); glVertex2d(-1, -1);
+        glTexCoord2d(s, 0); glVertex2d(1, -1);
+        glTexCoord2d(s, t); glVertex2d(1, 1);
+        glTexCoord2d(0, t); glVertex2d(-1, 1);
+    glEnd();
+
+    glutSwapBuffers();
+}
+
+/* Makes the output of a finished tile, and gives the part of the output
+ * that changed. The tent filter reaches into the neighbouring tiles, so
+ * their pixels next to this one change too.
+ */
+tile resolveTile(tile t)
+{
+    if (outputStage->getFilter() == FILTER_TENT)
+    {
+        t.width += (t.x > 0) + (t.x + t.width < imageWidth);
+        t.height += (t.y > 0) + (t.y + t.height < imageHeight);
+        t.x = max(t.x - 1, 0);
+        t.y = max(t.y - 1, 0);
+    }
+
+    outputStage->resolve(t.x, t.y, t.width, t.height);
+
+    return t;
+}
+
+/* Sends the tiles finished since the last time into the texture, and only
+ * then asks for the window to be drawn again.
+ */
+void refresh(int value)
+{
+    bool changed = false;
+    tile done;
+
+    while (tileQueue != NULL && tileQueue->pop(done))
+    {
+        tile t = resolveTile(done);
+
+        /* The rows of the tile are read from within the whole output. */
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, imageWidth);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, t.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, t.y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, t.x, t.y, t.width, t.height, GL_RGB, GL_UNSIGNED_BYTE,
+                outputStage->getPixels());
+        changed = true;
+
+        if (imageWriter != NULL)
+            imageWriter->tileDone(done);
+    }
+
+    if (changed)
+        glutPostRedisplay();
+
+    glutTimerFunc(REFRESH_PERIOD, refresh, 0);
+}
+
+/* Writes the settings of the render and the scene, which are all a worker
+ * needs, and reads them back in the worker.
+ */
+void packJob(Message &m)
+{
+    m.putInt(imageWidth);
+    m.putInt(imageHeight);
+    m.putInt(maxSamples);
+    m.putInt(samplePattern);
+    m.putDouble(adaptiveThreshold);
+    m.putInt(maxDepth);
+    m.putDouble(minContribution);
+    m.putInt(russianRoulette);
+    m.putDouble(rouletteThreshold);
+    m.putInt(rayBudget);
+    packScene(m);
+}
+
+bool unpackJob(Message &m)
+{
+    imageWidth = m.getInt();
+    imageHeight = m.getInt();
+    maxSamples = m.getInt();
+    samplePattern = m.getInt();
+    adaptiveThreshold = m.getDouble();
+    maxDepth = m.getInt();
+    minContribution = m.getDouble();
+    russianRoulette = m.getInt() != 0;
+    rouletteThreshold = m.getDouble();
+    rayBudget = m.getInt();
+
+    if (!m.isValid() || imageWidth < 1 || imageHeight < 1 || rayBudget < 0)
+        return false;
+
+    return unpackScene(m);
+}
+
+/* Sends the parts of the image that aren't traced, as if they were done. */
+void pushUntraced()
+{
+    tile parts[4];
+    int i, k;
+
+    for (i = 0; i < region->getNoGridTiles(); i++)
+    {
+        int n = region->getUntraced(i, parts);
+        for (k = 0; k < n; k++)
+            tileQueue->push(parts[k]);
+    }
+}
+
+/* The file of a frame: the output file, with the number of the frame before
+ * its extension.
+ */
+char *frameFileName(int frame)
+{
+    if (outputFile == NULL)
+        return NULL;
+
+    const char *dot = strrchr(outputFile, '.');
+    int length = dot != NULL ? (int) (dot - outputFile) : (int) strlen(outputFile);
+    char *name = new char[strlen(outputFile) + 16];
+    sprintf(name, "%.*s%03d%s", length, outputFile, frame, dot != NULL ? dot : "");
+
+    return name;
+}
+
+/* Traces the frames before the last one, each into its file, and moves the
+ * scene after each. The accelerator only follows what moved.
+ */
+void traceFrames()
+{
+    int frame, k, noMoved;
+    int *moved = new int[noObjects];
+    bvhBox *before = new bvhBox[noObjects];
+    tile done;
+
+    for (frame = 0; frame < noFrames - 1; frame++)
     {
-        for (j = 0; j < screenWidth/2 - 1; j++)
+        char *name = frameFileName(frame);
+        ImageWriter *writer = NULL;
+
+        if (name != NULL)
         {
-            /* RED. */
-            double value;
-
-           value = image[2*j][2*i].r + image[2*j][2*(i+1)].r +
-                   image[2*(j+1)][2*i].r + image[2*(j+1)][2*(i+1)].r;
-           pixels[i*(screenWidth/2*3) + j*3] = value / 4;
-
-            /* GREEN. */
-            value = image[2*j][2*i].g + image[2*j][2*(i+1)].g +
-                    image[2*(j+1)][2*i].g + image[2*(j+1)][2*(i+1)].g;
-            pixels[i*(screenWidth/2*3) + j*3 + 1] = value / 4;
-
-            /* BLUE. */
-            value = image[2*j][2*i].b + image[2*j][2*(i+1)].b +
-                    image[2*(j+1)][2*i].b + image[2*(j+1)][2*(i+1)].b;
-            pixels[i*(screenWidth/2*3) + j*3 + 2] = value / 4;
+            writer = new ImageWriter(name, imageWidth, imageHeight, outputStage->getPixels(),
+                    outputFilter == FILTER_TENT);
+            if (!writer->start())
+            {
+                printf("Could not write the image to %s.\n", name);
+                delete writer;
+                writer = NULL;
+            }
         }
+
+        startRender();
+        finishRender();
+
+        while (tileQueue->pop(done))
+        {
+            resolveTile(done);
+            if (writer != NULL)
+                writer->tileDone(done);
+        }
+
+        if (writer != NULL)
+        {
+            writer->finish();
+            delete writer;
+        }
+        delete [] name;
+
+        /* The shadows only change around the objects that move, so the
+         * boxes they leave are kept.
+         */
+        pushUntraced();
+        noMoved = animatedObjects(moved);
+        for (k = 0; k < noMoved; k++)
+            BVH::boxOf(objects[moved[k]], before[k], NULL);
+        animateScene(frame + 1, moved);
+        updateAccelerator(moved, noMoved);
+        updateShadowOccluders(moved, noMoved, before);
     }
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    delete [] moved;
+    delete [] before;
+}
 
-    /* Writes a block of pixels to the framebuffer. */
-    glDrawPixels(screenWidth/2,screenHeight/2,GL_RGB,GL_FLOAT, pixels);
+/* A worker traces the tiles its master gives it with the threads of the
+ * pool, and ends when the image is done.
+ */
+int runWorker()
+{
+    Message job;
 
-    glutSwapBuffers();
+    renderWorker = new RenderWorker(workerHost, workerPort);
+
+    if (!renderWorker->connect(job) || !unpackJob(job))
+    {
+        printf("Could not get a job from %s:%d.\n", workerHost, workerPort);
+        return 1;
+    }
+
+    sampler = new Sampler(samplePattern, maxSamples);
+    region = new RenderRegion(imageWidth, imageHeight, 0, 0, imageWidth, imageHeight, 0, -1);
+    buildAccelerator();
+    buildShadowOccluders();
+
+    startRender();
+    finishRender();
+    printf("Worker done.\n");
+
+    return 0;
 }
 
 int main(int argc, char** argv) {
     glutInit(&argc, argv);
 
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-    glutInitWindowSize(screenWidth/2, screenHeight/2);
-    glutCreateWindow("Our Fantastic Ray Tracer");
-
-    glutDisplayFunc(display);
-    //glutReshapeFunc(reshape);
-    //glutMouseFunc(mouse_button);
-    //glutMotionFunc(mouse_motion);
-    //glutKeyboardFunc(keyboard);
-    //glutIdleFunc(idle);
-
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.0, 0.0, 0.0, 1.0);
-    //glPointSize(2);
+    /* Reads the options. Anything else is the number of the scene. */
+    int i, sceneNo = 9;
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-aa") == 0 || strcmp(argv[i], "-spp") == 0) && i + 1 < argc)
+            maxSamples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-sampler") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "halton") == 0)
+                samplePattern = SAMPLER_HALTON;
+            else if (strcmp(argv[i], "bluenoise") == 0)
+                samplePattern = SAMPLER_BLUE_NOISE;
+            else
+                samplePattern = SAMPLER_STRATIFIED;
+        }
+        else if (strcmp(argv[i], "-res") == 0 && i + 2 < argc)
+        {
+            imageWidth = atoi(argv[++i]);
+            imageHeight = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+            adaptiveThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "-depth") == 0 && i + 1 < argc)
+            maxDepth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-contribution") == 0 && i + 1 < argc)
+            minContribution = atof(argv[++i]);
+        else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc)
+            outputFilter = strcmp(argv[++i], "tent") == 0 ? FILTER_TENT : FILTER_BOX;
+        else if (strcmp(argv[i], "-exposure") == 0 && i + 1 < argc)
+            exposure = atof(argv[++i]);
+        else if (strcmp(argv[i], "-tonemap") == 0)
+            tonemap = true;
+        else if (strcmp(argv[i], "-gamma") == 0 && i + 1 < argc)
+            outputGamma = atof(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outputFile = argv[++i];
+        else if (strcmp(argv[i], "-map") == 0 && i + 1 < argc)
+            mappedFile = argv[++i];
+        else if (strcmp(argv[i], "-tiled") == 0 && i + 1 < argc)
+            tiledFile = argv[++i];
+        else if (strcmp(argv[i], "-crop") == 0 && i + 4 < argc)
+        {
+            cropX = atoi(argv[++i]);
+            cropY = atoi(argv[++i]);
+            cropWidth = atoi(argv[++i]);
+            cropHeight = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-tiles") == 0 && i + 2 < argc)
+        {
+            firstTile = atoi(argv[++i]);
+            lastTile = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-master") == 0 && i + 1 < argc)
+            masterPort = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-worker") == 0 && i + 2 < argc)
+        {
+            workerHost = argv[++i];
+            workerPort = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-savescene") == 0 && i + 1 < argc)
+            sceneFile = argv[++i];
+        else if (strcmp(argv[i], "-serve") == 0 && i + 1 < argc)
+            servePort = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            noThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-noreplicas") == 0)
+            sceneReplicas = false;
+        else if (strcmp(argv[i], "-accel") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "lbvh") == 0)
+                acceleratorType = BVH_LBVH;
+            else if (strcmp(argv[i], "none") == 0)
+                acceleratorType = BVH_NONE;
+            else
+                acceleratorType = BVH_SAH;
+        }
+        else if (strcmp(argv[i], "-binarytree") == 0)
+            wideTree = false;
+        else if (strcmp(argv[i], "-compressbvh") == 0)
+            compressedTree = true;
+        else if (strcmp(argv[i], "-lazybvh") == 0)
+            lazyTree = true;
+        else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            noFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-onelevel") == 0)
+            twoLevels = false;
+        else if (strcmp(argv[i], "-hugepages") == 0)
+            HugePages::setEnabled(true);
+        else if (strcmp(argv[i], "-budget") == 0 && i + 1 < argc)
+            rayBudget = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-roulette") == 0 && i + 1 < argc)
+        {
+            russianRoulette = true;
+            rouletteThreshold = atof(argv[++i]);
+        }
+        else
+            sceneNo = atoi(argv[i]);
+    }
 
     visualizationType = LOOKING_AHEAD;
 
@@ -124,26 +549,207 @@ int main(int argc, char** argv) {
                 break;
     }
 
+    /* The image is read and written all over, so it is worth huge pages. */
+    HugePages::advise(image, sizeof(image));
+
+    /* This counter is only made to know if counting works, and is closed
+     * at once.
+     */
+    {
+        PerfCounter counter;
+        printf("Huge pages %s; TLB misses %s.\n", HugePages::isEnabled() ? "on" : "off",
+               counter.isCounting() ? "counted" : "can't be counted here");
+    }
+
+    /* The master leaves the tracing to its workers, so it needs no threads. */
+    if (masterPort <= 0)
+        threadPool = new ThreadPool(noThreads > 0 ? noThreads : ThreadPool::getNoProcessors(), true);
+
+    /* A worker gets everything else from its master. */
+    if (workerHost != NULL)
+        return runWorker();
+
+    /* The scene may only be written, for a render server. */
+    if (sceneFile != NULL)
+    {
+        Message scene;
+        buildScene(sceneNo);
+        packScene(scene);
+
+        if (!scene.save(sceneFile))
+        {
+            printf("Could not write the scene to %s.\n", sceneFile);
+            return 1;
+        }
+
+        printf("Scene written to %s.\n", sceneFile);
+        return 0;
+    }
+
+    /* A mapped or tiled image may be as large as a TGA file allows. */
+    bool outOfCore = mappedFile != NULL || tiledFile != NULL;
+    int widthLimit = outOfCore ? 65535 : SCREEN_W;
+    int heightLimit = outOfCore ? 65535 : SCREEN_H;
+
+    /* Only a single image may be traced out of core or by workers. */
+    if (noFrames < 1 || outOfCore || masterPort > 0)
+        noFrames = 1;
+
+    if (imageWidth < 1 || imageWidth > widthLimit)
+        imageWidth = SCREEN_W/2;
+    if (imageHeight < 1 || imageHeight > heightLimit)
+        imageHeight = SCREEN_H/2;
+    if (rayBudget < 0)
+        rayBudget = 0;
+    if (outputGamma <= 0)
+        outputGamma = 1.0;
+
+    /* A server gets the rest from each job. */
+    if (servePort > 0)
+    {
+        RenderServer server(servePort);
+        server.run();
+        return 1;
+    }
+
+    if (cropWidth < 0)
+        cropWidth = imageWidth;
+    if (cropHeight < 0)
+        cropHeight = imageHeight;
+
+    region = new RenderRegion(imageWidth, imageHeight, cropX, cropY, cropWidth, cropHeight,
+            firstTile, lastTile);
+    printf("Tracing %d of the %d tiles of the image.\n", region->getNoTiles(), region->getNoGridTiles());
+
+    if (region->getNoTiles() == 0)
+    {
+        printf("There is nothing to trace.\n");
+        return 1;
+    }
+
+    sampler = new Sampler(samplePattern, maxSamples);
+    outputStage = new OutputStage(imageWidth, imageHeight, outputFilter, exposure, tonemap, outputGamma);
+
+    if (tiledFile != NULL)
+    {
+        tiledImage = new TiledImage(tiledFile);
+
+        if (!tiledImage->create(imageWidth, imageHeight, region->getNoPixels()))
+        {
+            printf("Could not write the image to %s.\n", tiledFile);
+            return 1;
+        }
+    }
+    else if (mappedFile != NULL)
+    {
+        mappedImage = new MappedImage(mappedFile, imageWidth, imageHeight, region->getNoPixels());
+
+        if (!mappedImage->open())
+        {
+            printf("Could not map the image to %s.\n", mappedFile);
+            return 1;
+        }
+    }
+    else if (outputFile != NULL)
+    {
+        char *name = noFrames > 1 ? frameFileName(noFrames - 1) : outputFile;
+        imageWriter = new ImageWriter(name, imageWidth, imageHeight, outputStage->getPixels(),
+                outputFilter == FILTER_TENT);
+
+        if (!imageWriter->start())
+        {
+            printf("Could not write the image to %s.\n", name);
+            delete imageWriter;
+            imageWriter = NULL;
+        }
+    }
+
+    /* Room for all the tiles of the image, so no thread ever waits. The
+     * parts of the image that aren't traced are sent first, black, so the
+     * file is written whole.
+     */
+    if (!outOfCore)
+    {
+        tile parts[4];
+        int noParts = 0;
+
+        for (i = 0; i < region->getNoGridTiles(); i++)
+            noParts += region->getUntraced(i, parts);
+
+        tileQueue = new TileQueue(region->getNoTiles() + noParts);
+        pushUntraced();
+    }
+
+    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+    glutInitWindowSize(min(imageWidth, SCREEN_W/2), min(imageHeight, SCREEN_H/2));
+    glutCreateWindow("Our Fantastic Ray Tracer");
+
+    glutDisplayFunc(display);
+    //glutReshapeFunc(reshape);
+    //glutMouseFunc(mouse_button);
+    //glutMotionFunc(mouse_motion);
+    //glutKeyboardFunc(keyboard);
+    //glutIdleFunc(idle);
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+    //glPointSize(2);
+
+    /* The texture starts black, and the tiles are written over it. */
+    if (!outOfCore)
+    {
+        for (textureWidth = 1; textureWidth < imageWidth; textureWidth *= 2);
+        for (textureHeight = 1; textureHeight < imageHeight; textureHeight *= 2);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        unsigned char *black = (unsigned char *) calloc(textureWidth*textureHeight*3, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, black);
+        free(black);
+
+        glEnable(GL_TEXTURE_2D);
+        glutTimerFunc(REFRESH_PERIOD, refresh, 0);
+    }
+
 
     /* Builds the right scene. */
-    if (argc > 1)
-        buildScene(atoi(argv[1]));
-    else
-        buildScene(9);
+    buildScene(sceneNo);
+
+    /* The master leaves the tracing to its workers. */
+    if (masterPort > 0)
+    {
+        Message *job = new Message();
+        packJob(*job);
 
-    /* Starts the ray tracing process by creating two threads. */
-    thr_array = (pthread_t *)malloc(2*sizeof(pthread_t));
-    int threadOne = 0;
-    pthread_create(&thr_array[0], NULL, renderImage, &threadOne);
-    int threadTwo = 1;
-    pthread_create(&thr_array[1], NULL, renderImage, &threadTwo);
+        renderMaster = new RenderMaster(masterPort, job, region);
+        if (!renderMaster->start())
+        {
+            printf("Could not wait for workers on port %d.\n", masterPort);
+            return 1;
+        }
+    }
+    else
+    {
+        /* Builds the tree of boxes, finds out with it which objects can
+         * shadow something from each light, and then starts the ray tracing
+         * process with the threads of the pool. The master leaves all this
+         * to its workers.
+         */
+        buildAccelerator();
+        buildShadowOccluders();
+        traceFrames();
+        startRender();
+    }
 
     glutMainLoop();
 
     /* Now waits for the thread to conclude their work. */
     /*printf("Waiting for threads...\n");
-    pthread_join(thr_array[0],NULL);
-    pthread_join(thr_array[1],NULL);
+    finishRender();
     printf("Finished rendering!\n"); */
 
     return 0;
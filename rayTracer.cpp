@@ -5,6 +5,18 @@
 #include "Plane.h"
 #include "BasicStructures.h"
 #include "Object.h"
+#include "Sampler.h"
+#include "TileQueue.h"
+#include "OutputStage.h"
+#include "MappedImage.h"
+#include "TiledImage.h"
+#include "RenderRegion.h"
+#include "RenderWorker.h"
+#include "ThreadPool.h"
+#include "PerfCounter.h"
+#include "Arena.h"
+#include "BVH.h"
+#include "TopLevelBVH.h"
 #include <stdio.h>
 #include <windows.h>
 #include <GL/glut.h>
@@ -19,7 +31,30 @@ extern Light *lights;
 extern point camera;
 extern int screenWidth, screenHeight, screenSize;
 extern colour image[SCREEN_W][SCREEN_H];
+extern int imageWidth, imageHeight;
 extern int visualizationType;
+extern Sampler *sampler;
+extern TileQueue *tileQueue;
+extern OutputStage *outputStage;
+extern MappedImage *mappedImage;
+extern TiledImage *tiledImage;
+extern RenderRegion *region;
+extern RenderWorker *renderWorker;
+extern ThreadPool *threadPool;
+extern double adaptiveThreshold;
+extern int maxDepth;
+extern double minContribution;
+extern bool russianRoulette;
+extern double rouletteThreshold;
+extern int rayBudget;
+extern bool sceneReplicas;
+extern int acceleratorType;
+extern bool wideTree, compressedTree;
+extern int noFrames;
+extern BVH *bvh;
+extern TopLevelBVH *topLevel;
+extern bool twoLevels;
+extern bool lazyTree;
 
 /* All the coefficients that will make the plane.
  * a,b and c will go for x, y, z, while d is for the constant.
@@ -37,14 +72,411 @@ double setViewPlaneZCoordinate(double a, double b, double c, double d, double in
 
 }
 
-void rayTracer(Ray ray, int depth)
+/* The corners of the window where all the rays cast from the camera start,
+ * according to the visualization type.
+ */
+void viewWindowCorners(point corners[4])
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        double x = (i & 1) ? screenWidth : 0;
+        double y = (i & 2) ? screenHeight : 0;
+
+        if (visualizationType == LOOKING_DOWN)
+        {
+            corners[i].x = x;
+            corners[i].y = 1000;
+            corners[i].z = y;
+        }
+        else
+        {
+            corners[i].x = x;
+            corners[i].y = y;
+            corners[i].z = setViewPlaneZCoordinate(0, 0, 1, 0, 0, 0, x, y);
+        }
+    }
+}
+
+/* Searches the boxes of the objects with the accelerator, which must be
+ * built, or else one object at a time.
+ */
+bool searchScene(bvhQuery &query)
+{
+    int i;
+    bvhBox box;
+
+    if (topLevel != NULL)
+        return topLevel->search(query, false);
+    if (bvh != NULL)
+        return bvh->search(query, false);
+
+    for (i = 0; i < noObjects; i++)
+        if (BVH::boxOf(objects[i], box, NULL) && query.enters(box.lower, box.upper) && query.visit(i))
+            return true;
+
+    return false;
+}
+
+/* Most of the objects can't shadow anything we see from a given light, so
+ * we keep, for each light, only the ones that can. The accelerator must be
+ * built first, as it finds the objects near each shadow.
+ */
+void buildShadowOccluders()
+{
+    int z;
+    point corners[4];
+
+    viewWindowCorners(corners);
+
+    for (z = 0; z < noLights; z++)
+    {
+        lights[z].buildOccluders(corners, 4, searchScene);
+        printf("Light %d: %d of %d objects may cast shadows.\n", z, lights[z].getNoOccluders(), noObjects);
+    }
+}
+
+/* Follows the objects moved since the last frame, given the box each had
+ * before. The accelerator must be updated first.
+ */
+void updateShadowOccluders(const int *moved, int noMoved, const bvhBox *before)
+{
+    int z, noTried;
+    point corners[4];
+
+    viewWindowCorners(corners);
+
+    for (z = 0; z < noLights; z++)
+    {
+        double start = PerfCounter::now();
+        noTried = lights[z].updateOccluders(moved, noMoved, before, corners, 4, searchScene);
+        printf("Light %d: %d of %d objects may cast shadows, %d tried again in %.3f ms.\n", z,
+                lights[z].getNoOccluders(), noObjects, noTried, 1000 * (PerfCounter::now() - start));
+    }
+}
+
+/* Builds the tree of boxes around the objects, with the threads of the
+ * pool.
+ */
+void buildAccelerator()
+{
+    if (acceleratorType == BVH_NONE)
+        return;
+
+    /* An animated scene keeps the objects that move out of the tree of the
+     * others, or else a tree it can update.
+     */
+    if (noFrames > 1 && twoLevels)
+    {
+        int *moving = new int[noObjects];
+        int noMoving = animatedObjects(moving);
+
+        topLevel = new TopLevelBVH(acceleratorType, wideTree ? BVH_WIDTH : 2, compressedTree);
+        topLevel->getStaticTree()->setLazy(lazyTree);
+        topLevel->build(objects, noObjects, moving, noMoving, threadPool);
+        delete [] moving;
+
+        BVH *tree = topLevel->getStaticTree();
+        printf("Accelerator: %d-wide %s%s tree of %d nodes in %d KB under %d instances, built in %.3f s.\n",
+                tree->getWidth(), tree->isCompressed() ? "compressed " : "",
+                acceleratorType == BVH_LBVH ? "LBVH" : "SAH", tree->getNoNodes(),
+                (int) ((tree->getSize() + 1023) / 1024), topLevel->getNoInstances(), topLevel->getBuildTime());
+        return;
+    }
+
+    bvh = new BVH(acceleratorType, wideTree ? BVH_WIDTH : 2, compressedTree, noFrames > 1);
+    bvh->setLazy(lazyTree);
+    bvh->build(objects, noObjects, threadPool);
+    if (bvh->isLazy())
+        printf("Accelerator: lazy, with %d subtrees left to build as the rays reach them.\n",
+                bvh->getNoSubtrees());
+    printf("Accelerator: %d-wide %s%s tree of %d nodes in %d KB, built in %.3f s.\n", bvh->getWidth(),
+            bvh->isCompressed() ? "compressed " : "", acceleratorType == BVH_LBVH ? "LBVH" : "SAH",
+            bvh->getNoNodes(), (int) ((bvh->getSize() + 1023) / 1024), bvh->getBuildTime());
+}
+
+/* Makes the tree follow the objects moved since the last frame. */
+void updateAccelerator(const int *moved, int noMoved)
+{
+    if (topLevel != NULL)
+    {
+        topLevel->update(objects);
+        printf("Accelerator: top level of %d instances rebuilt in %.3f ms.\n",
+                topLevel->getNoInstances(), 1000 * topLevel->getUpdateTime());
+        return;
+    }
+
+    if (bvh == NULL)
+        return;
+
+    bvh->update(objects, moved, noMoved, threadPool);
+    printf("Accelerator: %d nodes refitted and %d subtrees rebuilt in %.3f ms.\n",
+            bvh->getNoRefitted(), bvh->getNoRebuilt(), 1000 * bvh->getUpdateTime());
+}
+
+/* Builds the ray that goes from a point to the light z. */
+Ray buildToLightRay(point p, int z)
+{
+    vector toLight = lights[z].getCentre() - p;
+
+    Ray toLightRay = Ray(p.x, p.y, p.z, 0, 0);
+    toLightRay.setDirection(toLight);
+    toLightRay.setIsToLight(true, sqrtf(toLightRay.getDir() * toLightRay.getDir()));
+    toLightRay.normalize();
+
+    return toLightRay;
+}
+
+/* Finds how much of the light z reaches the starting point of toLightRay,
+ * which lies on the object index. Neighbour pixels in shadow are usually
+ * blocked by the same object, so the last opaque object that blocked a ray
+ * to this light is tried before all the others. Then, the accelerator finds
+ * the objects along the ray, up to the light, and stops at the first opaque
+ * one. Only the objects that may shadow something from this light count.
+ */
+double shadowTransparency(Ray &toLightRay, int z, int index, renderContext *context)
+{
+    int k;
+    double t0, t1;
+    int last = context->lastOccluder[z];
+    bvhShadow shadow = {toLightRay.getToLightDistance(), index, lights[z].getCasts(), 1.0, -1};
+
+    if (last != -1 && last != index && context->objects[last]->intersects(toLightRay, t0, t1) &&
+            t0 <= shadow.distance)
+    {
+        context->occluderHits++;
+        return 0.0;
+    }
+    context->occluderMisses++;
+
+    if (context->topLevel != NULL)
+        context->topLevel->occluded(toLightRay, context->objects, shadow);
+    else if (context->bvh != NULL)
+        context->bvh->occluded(toLightRay, context->objects, shadow);
+    else
+        for (k = 0; k < lights[z].getNoOccluders(); k++)
+            if (dimShadow(shadow, context->objects[lights[z].getOccluder(k)], lights[z].getOccluder(k), toLightRay))
+                break;
+
+    /* Only opaque objects are remembered, because they are enough to tell,
+     * by themselves, that the point is in shadow.
+     */
+    if (shadow.blocker != -1)
+        context->lastOccluder[z] = shadow.blocker;
+
+    return shadow.transparency;
+}
+
+/* The search for the objects that shadow the rays of a tile to a light.
+ * Seen from the light, the rays fit inside a cone, so each box is tried
+ * once against the cone for the whole tile, and each object in the boxes
+ * left is tried against all the rays still lit.
+ */
+class tileShadowQuery : public bvhQuery
+{
+private:
+    renderContext *context;
+    int z, count;
+    point lightCentre;
+    vector axis;
+    double angle, maxDistance;
+public:
+    int active;
+
+    tileShadowQuery(renderContext *context, int z, int count, vector axis, double angle,
+                    double maxDistance, int active):
+        context(context),
+        z(z),
+        count(count),
+        lightCentre(lights[z].getCentre()),
+        axis(axis),
+        angle(angle),
+        maxDistance(maxDistance),
+        active(active)
+    { }
+
+    /* Whether the sphere enters the cone, before all the points. One with
+     * the light inside always does.
+     */
+    bool inCone(point c, double radius)
+    {
+        vector toSphere = c - lightCentre;
+        double distance = sqrt(toSphere * toSphere);
+
+        if (distance <= radius)
+            return true;
+        if (distance - radius > maxDistance)
+            return false;
+
+        double cosBetween = (toSphere * axis) / distance;
+        cosBetween = max(-1.0, min(1.0, cosBetween));
+
+        return acos(cosBetween) <= angle + asin(radius / distance);
+    }
+
+    bool enters(const float *lower, const float *upper)
+    {
+        point c = {0.5 * (lower[0] + upper[0]), 0.5 * (lower[1] + upper[1]), 0.5 * (lower[2] + upper[2])};
+        vector half = {0.5 * (upper[0] - lower[0]), 0.5 * (upper[1] - lower[1]), 0.5 * (upper[2] - lower[2])};
+
+        return inCone(c, sqrt(half * half));
+    }
+
+    bool visit(int object)
+    {
+        int r;
+        const bool *casts = lights[z].getCasts();
+
+        if (!casts[object])
+            return false;
+
+        for (r = 0; r < count; r++)
+        {
+            double *transparency = &context->transparency[r*noLights + z];
+
+            if (*transparency <= EPSLON)
+                continue;
+
+            bvhShadow shadow = {context->shadowRays[r].getToLightDistance(), context->hits[r], casts,
+                                *transparency, -1};
+            if (dimShadow(shadow, context->objects[object], object, context->shadowRays[r]))
+                active--;
+
+            *transparency = shadow.transparency;
+            if (shadow.blocker != -1)
+                context->lastOccluder[z] = shadow.blocker;
+        }
+
+        return active == 0;
+    }
+};
+
+/* All the shadow rays of a tile that go to the same light meet at its centre,
+ * so the occluders are searched for once for the whole tile, with a cone
+ * around the rays, and each one found is tested against all the rays still
+ * lit, one occluder at a time.
+ */
+void shadowBatch(renderContext *context, int z, int count)
+{
+    int r, k;
+    double t0, t1;
+    point lightCentre = lights[z].getCentre();
+    vector axis = {0, 0, 0};
+    double cosAngle = 1.0, maxDistance = 0;
+    int active = 0;
+
+    /* First, the rays that really need a test to this light. */
+    for (r = 0; r < count; r++)
+    {
+        double *transparency = &context->transparency[r*noLights + z];
+        *transparency = -1;
+
+        if (context->hits[r] == -1)
+            continue;
+
+        point p = context->rays[r].getOrigin();
+        if (context->normals[r] * (lightCentre - p) < EPSLON)
+            continue;
+
+        context->shadowRays[r] = buildToLightRay(p, z);
+        *transparency = 1.0;
+        active++;
+
+        /* The direction from the light to the point. */
+        vector fromLight = -1 * context->shadowRays[r].getDir();
+        axis += fromLight;
+        maxDistance = max(maxDistance, context->shadowRays[r].getToLightDistance());
+    }
+
+    if (active == 0)
+        return;
+
+    /* The cone around all the rays. If they spread too much, we don't
+     * try to cull anything.
+     */
+    double axisLength = sqrt(axis * axis);
+    if (axisLength > EPSLON)
+    {
+        axis /= axisLength;
+        for (r = 0; r < count; r++)
+            if (context->transparency[r*noLights + z] > 0)
+                cosAngle = min(cosAngle, (-1 * context->shadowRays[r].getDir()) * axis);
+    }
+    else
+        cosAngle = -1;
+
+    double angle = acos(max(-1.0, min(1.0, cosAngle)));
+
+    /* The last occluder is tried first, as in shadowTransparency(). */
+    int last = context->lastOccluder[z];
+    for (r = 0; r < count; r++)
+    {
+        double *transparency = &context->transparency[r*noLights + z];
+
+        if (*transparency < 0)
+            continue;
+
+        if (last != -1 && last != context->hits[r] && context->objects[last]->intersects(context->shadowRays[r], t0, t1) &&
+                t0 <= context->shadowRays[r].getToLightDistance())
+        {
+            context->occluderHits++;
+            *transparency = 0.0;
+            active--;
+        }
+        else
+            context->occluderMisses++;
+    }
+
+    if (active == 0)
+        return;
+
+    tileShadowQuery query(context, z, count, axis, angle, maxDistance, active);
+
+    /* The objects with no box are tried first, and then the tree opens only
+     * the boxes inside the cone, building the ones of a lazy tree, as the
+     * rays would. Without a tree, the spheres of the occluders are tried.
+     */
+    if (context->topLevel != NULL || context->bvh != NULL)
+    {
+        for (k = 0; k < lights[z].getNoUnbounded() && query.active > 0; k++)
+            query.visit(lights[z].getUnbounded(k));
+
+        if (query.active > 0 && context->topLevel != NULL)
+            context->topLevel->search(query, true);
+        else if (query.active > 0)
+            context->bvh->search(query, true);
+    }
+    else
+        for (k = 0; k < lights[z].getNoOccluders(); k++)
+        {
+            point c;
+            double radius;
+
+            if (lights[z].getOccluderSphere(k, c, radius) && !query.inCone(c, radius))
+                continue;
+            if (query.visit(lights[z].getOccluder(k)))
+                break;
+        }
+}
+
+/* Finds the closest object hit by the ray, or -1 if there is none. */
+int closestObject(Ray &ray, double &minT0, double &minT1, renderContext *context)
 {
-    int i, z, index;
-    double minT0 = -1, minT1 = -1, t0, t1;
+    int i, index = -1;
+    double t0, t1;
+
+    if (context->topLevel != NULL)
+        return context->topLevel->closest(ray, context->objects, minT0, minT1);
+    if (context->bvh != NULL)
+        return context->bvh->closest(ray, context->objects, minT0, minT1);
+
+    minT0 = -1;
+    minT1 = -1;
 
     /* Goes through all the objects in the scene. */
     for (i = 0; i < noObjects; i++)
-        if (objects[i]->intersects(ray, t0, t1))
+        if (context->objects[i]->intersects(ray, t0, t1))
         {
             /* Finds the closest. */
             if (t0 < minT0 || minT0 == -1)
@@ -55,230 +487,887 @@ void rayTracer(Ray ray, int depth)
             }
         }
 
-    /* We have found at least one intersection. */
-    if (minT0 != -1)
-    {
-        /* Used in the Blinn-Phong calculation. */
-        vector oldDir = ray.getDir();
+    return index;
+}
 
-        /* There can be also refraction. In that case, we start a new call
-         * of the function and from this moment on, the ray splits into two.
-         */
-        if (objects[index]->getRefraction() > 0)
+/* The position, in the buffers of the tile, of the pixel (x, y). There is
+ * a border of one pixel around the tile.
+ */
+inline int tileCell(renderContext *context, int x, int y)
+{
+    return (x - context->tileX + 1) + (y - context->tileY + 1) * (TILE_SIZE + 2);
+}
+
+void rayTracer(Ray ray, int depth, renderContext *context);
+
+/* Mixes the bits of h, so close numbers give unrelated ones. */
+inline unsigned int mixBits(unsigned int h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/* A random number in [0, 1) for the ray, after depth bounces. It only
+ * depends on the pixel, the sample and the depth, so each ray gets the same
+ * one however the image is cut into tiles, and whichever thread traces it.
+ */
+inline double randomUnit(Ray &ray, int depth)
+{
+    unsigned int h = mixBits(ray.getHPos() + 0x9e3779b9u);
+
+    h = mixBits(h ^ ray.getWPos());
+    h = mixBits(h ^ ray.getSample());
+    h = mixBits(h ^ depth);
+
+    return h / 4294967296.0;
+}
+
+/* Decides if a ray that leaves the object index, after depth bounces, must
+ * stop. It stops at the depth of the object, or of the render, and when all
+ * it could still add to the pixel is below minContribution. With the russian
+ * roulette, a weak ray stops at random instead, and the ones that go on
+ * carry the energy of those that stopped, so the mean doesn't change.
+ */
+bool stopRay(Ray &ray, int index, int depth, renderContext *context)
+{
+    int limit = context->objects[index]->getMaxDepth() >= 0 ? context->objects[index]->getMaxDepth() : maxDepth;
+
+    if (depth >= limit || ray.getIntensity() <= EPSLON)
+        return true;
+
+    if (russianRoulette)
+    {
+        if (ray.getIntensity() < rouletteThreshold)
         {
-           Ray refractionRay = ray;
-
-           /* Sets the new starting point of the ray, at the 'other
-            * side' of the object. This point was previously calculated
-            * at the intersection function. Also, if there is some problem
-            * with this point (i.e., not a valid point, due, maybe, to the
-            * the fact that the ray only intersects the object at one point),
-            * the method return false and we won't make the recursive call.
-            */
-           if (objects[index]->refractionRedirection(refractionRay, minT0, minT1))
-           {
-               /* Sets the new intensity of the ray. */
-               refractionRay.setIntensity(refractionRay.getIntensity()*objects[index]->getRefraction());
-
-               /* Recursively starts a new ray, now for the refraction. */
-               rayTracer(refractionRay, depth + 1);
-           }
+            double survival = ray.getIntensity() / rouletteThreshold;
+
+            if (randomUnit(ray, depth) >= survival)
+            {
+                context->earlyStops++;
+                return true;
+            }
+
+            ray.setIntensity(rouletteThreshold);
         }
+    }
+    else if (ray.getIntensity() < minContribution)
+    {
+        context->earlyStops++;
+        return true;
+    }
 
-        /* Calculate the new direction of the ray. */
-        objects[index]->newDirection(ray, minT0);
+    return false;
+}
 
-        /* Then, calculate the lighting at this point. */
-        for (z = 0; z < noLights; z++)
+/* Adds the colour gathered by a ray that won't go any further to its pixel. */
+void depositRay(Ray &ray, renderContext *context)
+{
+    ray.normalizeColour();
+
+    int cell = tileCell(context, ray.getHPos(), ray.getWPos());
+    context->tileColour[cell].r += ray.getR();
+    context->tileColour[cell].g += ray.getG();
+    context->tileColour[cell].b += ray.getB();
+}
+
+/* There can be also refraction. In that case, from this moment on, the ray
+ * splits into two, and refractionRay gets the new one. Returns false if
+ * there's no refraction.
+ */
+bool splitRefraction(Ray &ray, int index, double minT0, double minT1, Ray &refractionRay, renderContext *context)
+{
+    if (context->objects[index]->getRefraction() > 0)
+    {
+       refractionRay = ray;
+
+       /* Sets the new starting point of the ray, at the 'other
+        * side' of the object. This point was previously calculated
+        * at the intersection function. Also, if there is some problem
+        * with this point (i.e., not a valid point, due, maybe, to the
+        * the fact that the ray only intersects the object at one point),
+        * the method return false and we won't follow the new ray.
+        */
+       if (context->objects[index]->refractionRedirection(refractionRay, minT0, minT1))
+       {
+           /* Sets the new intensity of the ray. */
+           refractionRay.setIntensity(refractionRay.getIntensity()*context->objects[index]->getRefraction());
+           return true;
+       }
+    }
+
+    return false;
+}
+
+/* The rays still to be traced for the current primary ray are kept in a
+ * heap, the ray that may add most to the pixel at the top.
+ */
+void swapPending(renderContext *context, int i, int j)
+{
+    Ray ray = context->pending[i];
+    int depth = context->pendingDepth[i];
+
+    context->pending[i] = context->pending[j];
+    context->pendingDepth[i] = context->pendingDepth[j];
+    context->pending[j] = ray;
+    context->pendingDepth[j] = depth;
+}
+
+void pushPending(renderContext *context, Ray &ray, int depth)
+{
+    int i = context->noPending++;
+
+    context->pending[i] = ray;
+    context->pendingDepth[i] = depth;
+
+    while (i > 0 && context->pending[(i - 1) / 2].getIntensity() < context->pending[i].getIntensity())
+    {
+        swapPending(context, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void popPending(renderContext *context, Ray &ray, int &depth)
+{
+    int i = 0;
+
+    ray = context->pending[0];
+    depth = context->pendingDepth[0];
+
+    context->noPending--;
+    if (context->noPending == 0)
+        return;
+
+    context->pending[0] = context->pending[context->noPending];
+    context->pendingDepth[0] = context->pendingDepth[context->noPending];
+
+    while (2*i + 1 < context->noPending)
+    {
+        int child = 2*i + 1;
+
+        if (child + 1 < context->noPending &&
+                context->pending[child + 1].getIntensity() > context->pending[child].getIntensity())
+            child++;
+
+        if (context->pending[child].getIntensity() <= context->pending[i].getIntensity())
+            break;
+
+        swapPending(context, i, child);
+        i = child;
+    }
+}
+
+/* Calculates the lighting at the point where the ray now starts, on the object
+ * index. The transparency of each light may have been found already by
+ * shadowBatch(); otherwise, transparencies is NULL and the shadow rays are
+ * cast here.
+ */
+void shadeHit(Ray &ray, int index, vector oldDir, vector normal, double *transparencies, renderContext *context)
+{
+    int z;
+    colour diffuse = context->objects[index]->getDiffuse(ray.getOrigin());
+
+    for (z = 0; z < noLights; z++)
+    {
+        /* The directional vector between the intersection point and the light. */
+        vector toLight;
+        toLight = lights[z].getCentre() - ray.getOrigin();
+
+        /* The transparent coefficient is used when we are looking for intersections
+         * between the intersection point and the lights (to know if we are in the
+         * shadow of another object or not). However, transparent objects (with refraction
+         * greater than 0.0), will count as intersections, but we know that they will still
+         * allow some light to pass. Therefore, we have to keep a coefficient that will
+         * go to 0.0 in case we find an opaque object between the intersection point
+         * and the light.
+         */
+        double transparencyCoef;
+
+        /* If the normal is perpendicular or is in opposite direction of the light,
+         * we can skip this light because it's not going to light the intersection
+         * point.
+         */
+        if (normal * toLight < EPSLON)
+            continue;
+
+        /* Now, we have to see if we are in the shadow of any other object.
+         * For that, we create a temporary ray that goes from the intersection
+         * point to the light spot.
+         */
+        Ray toLightRay = buildToLightRay(ray.getOrigin(), z);
+
+        if (transparencies != NULL)
+            transparencyCoef = transparencies[z];
+        else
+            transparencyCoef = shadowTransparency(toLightRay, z, index, context);
+
+        /* We aren't in shadow of any other object. Therefore, we have to calculate
+         * the contribution of this light to the final result.
+         */
+        if (transparencyCoef > EPSLON)
         {
-            /* The directional vector between the intersection point and the light. */
-            vector toLight, normal;
-            toLight = lights[z].getCentre() - ray.getOrigin();
-
-            /* We also need to calculate the normal at the intersection point. */
-            objects[index]->intersectionPointNormal(ray, normal);
-
-            /* The transparent coefficient is used when we are looking for intersections
-             * between the intersection point and the lights (to know if we are in the
-             * shadow of another object or not). However, transparent objects (with refraction
-             * greater than 0.0), will count as intersections, but we know that they will still
-             * allow some light to pass. Therefore, we have to keep a coefficient that will
-             * go to 0.0 in case we find an opaque object between the intersection point
-             * and the light.
+            /* The Lambert Effect. Depending on the direction of the light, it might
+             * be more or less intense.
              */
-            double transparencyCoef = 1.0;
+            double lambert = (toLightRay.getDir() * normal * ray.getIntensity());
 
-            /* If the normal is perpendicular or is in opposite direction of the light,
-             * we can skip this light because it's not going to light the intersection
-             * point.
+            /* Updates the colour of the ray. */
+            /* The smaller the transparency coefficient is, the darker is the shadow produced
+             * by the objects.
              */
-            if (normal * toLight < EPSLON)
-                continue;
+            ray.increaseR(lambert*lights[z].getR()*diffuse.r * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
+            ray.increaseG(lambert*lights[z].getG()*diffuse.g * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
+            ray.increaseB(lambert*lights[z].getB()*diffuse.b * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
 
-            /* Now, we have to see if we are in the shadow of any other object.
-             * For that, we create a temporary ray that goes from the intersection
-             * point to the light spot.
-             */
-            Ray toLightRay = Ray(ray.getOrigin().x, ray.getOrigin().y, ray.getOrigin().z, 0, 0);
-            toLightRay.setDirection(toLight);
-            toLightRay.setIsToLight(true, sqrtf(toLightRay.getDir() * toLightRay.getDir()));
-            toLightRay.normalize();
-
-            for (i = 0; i < noObjects && transparencyCoef > EPSLON; i++)
-                /* It can't intersect with itself. */
-                if (objects[i]->intersects(toLightRay, t0, t1) && index != i)
-                    transparencyCoef *= objects[i]->getRefraction();
-
-            /* We aren't in shadow of any other object. Therefore, we have to calculate
-             * the contribution of this light to the final result.
+            /* The Blinn-Phong Effect.
+             * The direction of Blinn is exactly at mid point of the light ray
+             * and the view ray.
+             * We compute the Blinn vector and then we normalize it
+             * then we compute the coeficient of blinn
+             * which is the specular contribution of the current light.
              */
-            if (transparencyCoef > EPSLON)
+            vector blinnDir = toLightRay.getDir() - oldDir;
+            double internProd = blinnDir * blinnDir;
+
+            if (internProd != 0.0 )
             {
-                /* The Lambert Effect. Depending on the direction of the light, it might
-                 * be more or less intense.
-                 */
-                double lambert = (toLightRay.getDir() * normal * ray.getIntensity());
+                double fViewProjection = oldDir * normal;
+                double fLightProjection = toLightRay.getDir() * normal;
 
-                /* Updates the colour of the ray. */
+                /* Calculates the coeficient and then applies it to each colour component. */
+                double blinnCoef = 1.0/sqrtf(internProd) * max(fLightProjection - fViewProjection , 0.0);
+                blinnCoef = ray.getIntensity() * powf(blinnCoef, context->objects[index]->getShininess());
                 /* The smaller the transparency coefficient is, the darker is the shadow produced
                  * by the objects.
                  */
-                ray.increaseR(lambert*lights[z].getR()*objects[index]->getR() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-                ray.increaseG(lambert*lights[z].getG()*objects[index]->getG() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-                ray.increaseB(lambert*lights[z].getB()*objects[index]->getB() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-
-                /* The Blinn-Phong Effect.
-                 * The direction of Blinn is exactly at mid point of the light ray
-                 * and the view ray.
-                 * We compute the Blinn vector and then we normalize it
-                 * then we compute the coeficient of blinn
-                 * which is the specular contribution of the current light.
-                 */
-                vector blinnDir = toLightRay.getDir() - oldDir;
-                double internProd = blinnDir * blinnDir;
-
-                if (internProd != 0.0 )
-                {
-                    double fViewProjection = oldDir * normal;
-                    double fLightProjection = toLightRay.getDir() * normal;
-
-                    /* Calculates the coeficient and then applies it to each colour component. */
-                    double blinnCoef = 1.0/sqrtf(internProd) * max(fLightProjection - fViewProjection , 0.0);
-                    blinnCoef = ray.getIntensity() * powf(blinnCoef, objects[index]->getShininess());
-                    /* The smaller the transparency coefficient is, the darker is the shadow produced
-                     * by the objects.
-                     */
-                    ray.increaseR(blinnCoef * objects[index]->getSpecular().r  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-                    ray.increaseG(blinnCoef * objects[index]->getSpecular().g  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-                    ray.increaseB(blinnCoef * objects[index]->getSpecular().b  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
-                }
-            } /* if (!inShadow)*/
+                ray.increaseR(blinnCoef * context->objects[index]->getSpecular().r  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
+                ray.increaseG(blinnCoef * context->objects[index]->getSpecular().g  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
+                ray.increaseB(blinnCoef * context->objects[index]->getSpecular().b  * lights[z].getIntensity() * transparencyCoef * lights[z].getFade(toLightRay.getToLightDistance()));
+            }
+        } /* if (!inShadow)*/
+    }
+}
+
+/* We have reached the limit of recursivity for ray tracing.
+ * Consequently, we assume that we can't reach the light and
+ * therefore, the pixel colour will be black, corresponding
+ * to the absence of colour.
+ * If we don't have any intersection, there's no point keep
+ * calculating the ray tracing. Also, the ray might not carry
+ * enough energy to change the pixel.
+ */
+void continueRay(Ray &ray, int index, int depth, renderContext *context)
+{
+    if (index == -1 || stopRay(ray, index, depth, context))
+        depositRay(ray, context);
+    /* The ray waits for the next level of recursivity. */
+    else
+        pushPending(context, ray, depth + 1);
+}
+
+void rayTracer(Ray ray, int depth, renderContext *context)
+{
+    double minT0, minT1;
+    int index = closestObject(ray, minT0, minT1, context);
+
+    /* We have found at least one intersection. */
+    if (index != -1)
+    {
+        /* Used in the Blinn-Phong calculation. */
+        vector oldDir = ray.getDir();
+        vector normal;
+        Ray refractionRay;
+
+        if (splitRefraction(ray, index, minT0, minT1, refractionRay, context))
+            continueRay(refractionRay, index, depth, context);
+
+        /* Calculate the new direction of the ray. */
+        context->objects[index]->newDirection(ray, minT0);
+
+        /* We also need to calculate the normal at the intersection point. */
+        context->objects[index]->intersectionPointNormal(ray, normal);
+
+        /* Then, calculate the lighting at this point. */
+        shadeHit(ray, index, oldDir, normal, NULL, context);
+
+        ray.multIntensity(context->objects[index]->getReflection());
+    }
+
+    continueRay(ray, index, depth, context);
+
+    return;
+}
+
+/* Follows the rays spawned by one primary ray, the strongest first, until
+ * rayBudget of them have been traced. Those left get the colour they have
+ * gathered so far, so a pixel full of glass and mirrors can't take longer
+ * than its budget.
+ */
+void traceRayTree(renderContext *context)
+{
+    int traced = 0, depth;
+    Ray ray;
+
+    while (context->noPending > 0)
+    {
+        popPending(context, ray, depth);
+
+        if (traced < rayBudget)
+        {
+            rayTracer(ray, depth, context);
+            traced++;
+        }
+        else
+        {
+            depositRay(ray, context);
+            context->budgetStops++;
+        }
+    }
+}
+
+/* Traces the primary rays of a whole tile, gathered in context->rays. Each
+ * stage runs for all the rays before the next, so the shadow rays of the tile
+ * can be cast together, light by light. From the first bounce on, each ray
+ * carries on by itself, with its own budget.
+ */
+void traceTile(renderContext *context, int count)
+{
+    int r, z;
+    double minT0, minT1;
+
+    for (r = 0; r < count; r++)
+    {
+        Ray &ray = context->rays[r];
+
+        context->hits[r] = closestObject(ray, minT0, minT1, context);
+        if (context->hits[r] == -1)
+            continue;
+
+        context->oldDirs[r] = ray.getDir();
+        context->refracts[r] = splitRefraction(ray, context->hits[r], minT0, minT1, context->refracted[r], context);
+        context->objects[context->hits[r]]->newDirection(ray, minT0);
+        context->objects[context->hits[r]]->intersectionPointNormal(ray, context->normals[r]);
+    }
+
+    for (z = 0; z < noLights; z++)
+        shadowBatch(context, z, count);
+
+    for (r = 0; r < count; r++)
+    {
+        if (context->hits[r] != -1)
+        {
+            shadeHit(context->rays[r], context->hits[r], context->oldDirs[r], context->normals[r],
+                    &context->transparency[r*noLights], context);
+
+            context->rays[r].multIntensity(context->objects[context->hits[r]]->getReflection());
+
+            if (context->refracts[r])
+                continueRay(context->refracted[r], context->hits[r], 0, context);
         }
 
-        ray.multIntensity(objects[index]->getReflection());
+        continueRay(context->rays[r], context->hits[r], 0, context);
+        traceRayTree(context);
     }
+}
+
+/* Builds the ray cast from the camera through the point (sx, sy) of the
+ * image, given in pixels, which belongs to the pixel (x, y). Returns false
+ * if the visualization type isn't supported.
+ */
+bool primaryRay(double sx, double sy, int x, int y, Ray &ray)
+{
+    double z = 0;
+
+    /* The point in the view plane. Its size doesn't depend on the
+     * resolution of the image.
+     */
+    double viewX = sx * screenWidth / imageWidth;
+    double viewY = sy * screenHeight / imageHeight;
+
+    /* Orthogonal Perspective
+    Ray ray(x,y,-1000.0, y, x);
+    ray.setDirection(0,0,1.0);
+     */
 
-    /* We have reached the limit of recursivity for ray tracing.
-     * Consequently, we assume that we can't reach the light and
-     * therefore, the pixel colour will be black, corresponding
-     * to the absence of colour.
-     * If we don't have any intersection, there's no point keep
-     * calculating the ray tracing. Also, the ray might not carry
-     * any more energy.
+    /* Parameters:
+     *  a , b, c, d, initX, initY, x, y
      */
-    if (minT0 == -1 || depth == MAX_DEPTH || ray.getIntensity() <= EPSLON)
+    if (visualizationType == LOOKING_AHEAD)
     {
-        ray.normalizeColour();
-        image[ray.getHPos()][ray.getWPos()].r += ray.getR();
-        image[ray.getHPos()][ray.getWPos()].g += ray.getG();
-        image[ray.getHPos()][ray.getWPos()].b += ray.getB();
+        z = setViewPlaneZCoordinate(0, 0, 1, 0, 0, 0, (int) viewX, (int) viewY);
+
+        /* Conic Perspective. */
+        ray = Ray(viewX, viewY, z, y, x);
+        point pixelPoint = {viewX, viewY, z};
+        vector dir = pixelPoint - camera;
+        ray.setDirection(dir);
+        ray.normalize();
+        //printf("%lf %lf %lf\n", ray.getDir().x, ray.getDir().y, ray.getDir().z);
+        return true;
+    }
+    else if (visualizationType == LOOKING_DOWN)
+    {
+        //z = setViewPlaneZCoordinate(0, 1, 0, 0, 500, 100, x,y);
+        z = 1000;
+        /* Conic Perspective. */
+        ray = Ray(viewX, z, viewY, y, x);
+        point pixelPoint = {viewX, z, viewY};
+        vector dir = pixelPoint - camera;
+        ray.setDirection(dir);
+        ray.normalize();
+        //printf("%lf %lf %lf\n", ray.getDir().x, ray.getDir().y, ray.getDir().z);
+        return true;
     }
-    /* We need to move to the next level of recursivity. */
-    else
-            rayTracer(ray, depth + 1);
 
-    return;
+    return false;
 }
 
-/* Type will define whether we are rendering the lower part of the image
- * or the upper.
+/* A pixel is refined if it sees an object different from the one seen by
+ * any of its neighbours, or if their colours are too far apart.
  */
-void *renderImage(void *type)
+bool needsRefinement(renderContext *context, int x, int y)
 {
-    int x, y;
-    double z = 0;
-    int limitY;
-    
-    /* Top rendering. */
-    if ((*(int* )type) == 0)
-    {
-        printf("One thread here.\n");
-        y = 0;
-        limitY = screenHeight/2;
-        //y = 500;
-        //limitY = 650;
-        //y = 0;
-        //limitY = screenHeight/2 - screenHeight/8;
-    
-    } else  /* Lower rendering. */
+    int i;
+    int cell = tileCell(context, x, y);
+    int neighbours[4][2] = {{x - 1, y}, {x + 1, y}, {x, y - 1}, {x, y + 1}};
+    colour c = context->tileColour[cell] / context->tileSamples[cell];
+
+    for (i = 0; i < 4; i++)
+    {
+        int nx = neighbours[i][0], ny = neighbours[i][1];
+
+        if (nx < 0 || ny < 0 || nx >= imageWidth || ny >= imageHeight)
+            continue;
+
+        int other = tileCell(context, nx, ny);
+        if (context->tileIds[other] != context->tileIds[cell])
+            return true;
+
+        colour n = context->tileColour[other] / context->tileSamples[other];
+        if (fabs(n.r - c.r) > adaptiveThreshold || fabs(n.g - c.g) > adaptiveThreshold ||
+                fabs(n.b - c.b) > adaptiveThreshold)
+            return true;
+    }
+
+    return false;
+}
+
+/* Renders the pixels of the rectangle that starts at (tileX, tileY). The
+ * pixels are first traced with a single sample. Then, only those at the
+ * edges of objects or at strong changes of colour are traced again, with
+ * the samples given by the sampler. To find the edges on the sides
+ * of the tile, the pixels around it are traced with a single sample too.
+ */
+void renderTile(renderContext *context, int tileX, int tileY, int width, int height)
+{
+    int x, y, i, r, count;
+    int noSamples = sampler->getNoSamples();
+    double sx, sy;
+    int noRefined = 0;
+
+    context->tileX = tileX;
+    context->tileY = tileY;
+
+    for (i = 0; i < (TILE_SIZE + 2) * (TILE_SIZE + 2); i++)
     {
-        printf("Another thread here.\n");
-        y = screenHeight/2;
-        limitY = screenHeight;
-        //y = 650;
-        //limitY = 800;
-        //y = screenHeight/2 - screenHeight/8;
-        //limitY = screenHeight;
+        context->tileColour[i] = 0.0;
+        context->tileSamples[i] = 0;
+        context->tileIds[i] = -1;
+    }
+
+    /* First, one sample at the centre of each pixel. */
+    count = 0;
+    for (y = max(tileY - 1, 0); y <= tileY + height && y < imageHeight; y++)
+        for (x = max(tileX - 1, 0); x <= tileX + width && x < imageWidth; x++)
+            if (primaryRay(x + 0.5, y + 0.5, x, y, context->rays[count]))
+                count++;
 
+    traceTile(context, count);
+    context->samples += count;
+
+    for (r = 0; r < count; r++)
+    {
+        int cell = tileCell(context, context->rays[r].getHPos(), context->rays[r].getWPos());
+        context->tileSamples[cell] = 1;
+        context->tileIds[cell] = context->hits[r];
     }
 
+    /* Then, we find the pixels to refine, before any of them changes. */
+    if (noSamples > 1)
+        for (y = tileY; y < tileY + height; y++)
+            for (x = tileX; x < tileX + width; x++)
+                if (context->tileSamples[tileCell(context, x, y)] > 0 && needsRefinement(context, x, y))
+                    context->refined[noRefined++] = tileCell(context, x, y);
 
-    for (; y < limitY; y++)
+    /* The sample at the centre is replaced by those of the sampler. */
+    count = 0;
+    for (r = 0; r < noRefined; r++)
     {
-            for (x = 0; x < screenWidth; x++)
+        int cell = context->refined[r];
+        x = cell % (TILE_SIZE + 2) - 1 + tileX;
+        y = cell / (TILE_SIZE + 2) - 1 + tileY;
+
+        context->tileColour[cell] = 0.0;
+        context->tileSamples[cell] = noSamples;
+
+        for (i = 0; i < noSamples; i++)
+        {
+            sampler->getSample(x, y, i, sx, sy);
+            primaryRay(sx, sy, x, y, context->rays[count]);
+            context->rays[count++].setSample(i + 1);
+
+            if (count == MAX_BATCH)
             {
-                /* Orthogonal Perspective
-                Ray ray(x,y,-1000.0, y, x);
-                ray.setDirection(0,0,1.0);
-                 */
+                traceTile(context, count);
+                context->samples += count;
+                count = 0;
+            }
+        }
+    }
 
-                /* Parameters:
-                 *  a , b, c, d, initX, initY, x, y
-                 */
-                if (visualizationType == LOOKING_AHEAD)
-                {
-                    z = setViewPlaneZCoordinate(0, 0, 1, 0, 0, 0, x,y);
-
-                    /* Conic Perspective. */
-                    Ray ray(x,y, z, y, x);
-                    point pixelPoint = {0.5 + x, 0.5 + y, z};
-                    vector dir = pixelPoint - camera;
-                    ray.setDirection(dir);
-                    ray.normalize();
-                    //printf("%lf %lf %lf\n", ray.getDir().x, ray.getDir().y, ray.getDir().z);
-                    rayTracer(ray, 0);
-                }
-                else if (visualizationType == LOOKING_DOWN)
-                {
-                    //z = setViewPlaneZCoordinate(0, 1, 0, 0, 500, 100, x,y);
-                    z = 1000;
-                    /* Conic Perspective. */
-                    Ray ray(x,z, y, y, x);
-                    point pixelPoint = {0.5 + x, z, 0.5 + y};
-                    vector dir = pixelPoint - camera;
-                    ray.setDirection(dir);
-                    ray.normalize();
-                    //printf("%lf %lf %lf\n", ray.getDir().x, ray.getDir().y, ray.getDir().z);
-                    rayTracer(ray, 0);
-                }
+    traceTile(context, count);
+    context->samples += count;
+
+    /* Finally, each pixel gets the mean of its samples. */
+    colour pixels[TILE_SIZE * TILE_SIZE];
+
+    for (y = tileY; y < tileY + height; y++)
+        for (x = tileX; x < tileX + width; x++)
+        {
+            int cell = tileCell(context, x, y);
+
+            if (context->tileSamples[cell] > 0)
+                pixels[(y - tileY) * width + x - tileX] = context->tileColour[cell] / context->tileSamples[cell];
+            else
+                pixels[(y - tileY) * width + x - tileX] = 0.0;
         }
 
-        /* If it's an even number, we will display the image, because we already
-         * have some information to do so.
-         */
-        if ((y & 1) == 0)
-            glutPostRedisplay();
+    storeTile(tileX, tileY, width, height, pixels);
+}
+
+/* Keeps the pixels of a finished tile, row after row. A worker sends them
+ * to its master. When the image is a mapped file, the rows of the tile go
+ * straight into it; when it is a tiled file, the whole tile is added to
+ * it. Or else, they go into the image, and the window can show them.
+ */
+void storeTile(int x, int y, int width, int height, colour *pixels)
+{
+    tile t = {x, y, width, height};
+    int i, j;
+
+    if (renderWorker != NULL)
+    {
+        renderWorker->sendTile(t, pixels);
+        return;
+    }
+
+    if (mappedImage != NULL || tiledImage != NULL)
+    {
+        unsigned char out[TILE_SIZE * TILE_SIZE * 3];
+
+        for (j = 0; j < height; j++)
+            if (mappedImage != NULL)
+                outputStage->quantise(&pixels[j * width], width, mappedImage->getPixel(x, y + j), mappedImage->isBGR());
+            else
+                outputStage->quantise(&pixels[j * width], width, &out[j * width * 3], false);
+
+        if (mappedImage != NULL)
+            mappedImage->written(width * height);
+        else
+            tiledImage->writeTile(t, out);
+        return;
+    }
+
+    for (j = 0; j < height; j++)
+        for (i = 0; i < width; i++)
+            image[x + i][y + j] = pixels[j * width + i];
+
+    if (tileQueue != NULL)
+        tileQueue->push(t);
+}
+
+/* The tiles of the region each node of the machine traces, and how many
+ * of them were taken. A node whose threads are done takes the tiles left
+ * to the others. Each share is kept in its own cache line, so the nodes
+ * don't fight over them. Then, the copies of the objects and of the tree
+ * kept on the node, and the arena the objects are made in.
+ */
+struct nodeShare
+{
+    int *tiles;
+    int noTiles;
+    volatile int next;
+    Object **objects;
+    Arena *arena;
+    BVH *bvh;
+    TopLevelBVH *topLevel;
+    char padding[64];
+};
+
+static nodeShare *shares = NULL;
+static int noShares = 0;
+static pthread_mutex_t sharesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The tasks tracing the region, one for each thread of the pool, how many
+ * are still tracing, and when they started.
+ */
+static int noTasks = 0;
+static volatile int noRunning = 0;
+static double renderStart;
+/* When the first tile was done, which a lazy tree makes sooner. */
+static volatile int firstTileDone = 0;
+static double firstTileTime;
+static int *taskIds = NULL;
+static Future **tasks = NULL;
+
+/* The node whose threads trace a tile. The image is kept column by column
+ * and a mapped file row by row, so each node gets a band of them. As the
+ * threads stay on their processors, the same node writes the same memory
+ * for every image, and the system keeps it on that node.
+ */
+static int tileNode(tile &t)
+{
+    if (mappedImage != NULL)
+        return (long long) t.y * noShares / imageHeight;
+
+    return (long long) t.x * noShares / imageWidth;
+}
+
+/* The copies of the objects and of the tree for the node of the thread,
+ * made by the first of its threads. A lazy tree grows as the rays get to
+ * it, so it is the one tree all the nodes share.
+ */
+static void nodeReplicas(renderContext &context)
+{
+    nodeShare &share = shares[context.node];
+
+    context.objects = objects;
+    context.bvh = bvh;
+    context.topLevel = topLevel;
+    if (noShares == 1 || !sceneReplicas)
+        return;
+
+    pthread_mutex_lock(&sharesMutex);
+    if (share.objects == NULL)
+    {
+        share.arena = new Arena();
+        share.objects = copyObjects(*share.arena);
+        share.bvh = bvh != NULL ? bvh->replicate() : NULL;
+        share.topLevel = topLevel != NULL ? topLevel->replicate() : NULL;
+    }
+    pthread_mutex_unlock(&sharesMutex);
+
+    context.objects = share.objects;
+    if (share.bvh != NULL)
+        context.bvh = share.bvh;
+    if (share.topLevel != NULL)
+        context.topLevel = share.topLevel;
+}
+
+/* Gives the next tile a thread must trace: one of its node's share, or of
+ * the next node with tiles left. In a worker, one from the master.
+ */
+static bool nextTile(renderContext *context, tile &t)
+{
+    int k;
+
+    if (renderWorker != NULL)
+        return renderWorker->nextTile(t);
+
+    for (k = 0; k < noShares; k++)
+    {
+        nodeShare &share = shares[(context->node + k) % noShares];
+        if (share.next >= share.noTiles)
+            continue;
+
+        int next = __sync_fetch_and_add(&share.next, 1);
+        if (next < share.noTiles)
+        {
+            t = region->getTile(share.tiles[next]);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* The threads of the pool trace the region, while we go on. */
+void startRender()
+{
+    int i;
+
+    /* The tiles of the region, by the node that traces them. */
+    noShares = threadPool->getNoNodes();
+    shares = new nodeShare[noShares];
+    for (i = 0; i < noShares; i++)
+    {
+        shares[i].tiles = new int[region->getNoTiles()];
+        shares[i].noTiles = 0;
+        shares[i].next = 0;
+        shares[i].objects = NULL;
+        shares[i].arena = NULL;
+        shares[i].bvh = NULL;
+        shares[i].topLevel = NULL;
+    }
+
+    for (i = 0; i < region->getNoTiles(); i++)
+    {
+        tile t = region->getTile(i);
+        nodeShare &share = shares[tileNode(t)];
+        share.tiles[share.noTiles++] = i;
+    }
+
+    noTasks = threadPool->getNoThreads();
+    noRunning = noTasks;
+    firstTileDone = 0;
+    firstTileTime = 0;
+    renderStart = PerfCounter::now();
+    taskIds = new int[noTasks];
+    tasks = new Future*[noTasks];
+
+    for (i = 0; i < noTasks; i++)
+    {
+        taskIds[i] = i;
+        tasks[i] = threadPool->submit(renderImage, &taskIds[i]);
+    }
+}
+
+/* Waits until the threads are done with the region. */
+void finishRender()
+{
+    int i;
+
+    for (i = 0; i < noTasks; i++)
+    {
+        tasks[i]->wait();
+        delete tasks[i];
+    }
+
+    delete [] tasks;
+    delete [] taskIds;
+    tasks = NULL;
+    taskIds = NULL;
+    noTasks = 0;
+
+    for (i = 0; i < noShares; i++)
+    {
+        delete shares[i].arena;
+        delete shares[i].bvh;
+        delete shares[i].topLevel;
+        delete [] shares[i].tiles;
+    }
+
+    delete [] shares;
+    shares = NULL;
+    noShares = 0;
+}
+
+/* Id is the number of the thread, among those tracing the region. */
+void *renderImage(void *id)
+{
+    int i;
+    long long pixels = 0;
+
+    /* The data that belongs only to this thread. */
+    renderContext context;
+    context.id = *(int* )id;
+    context.node = ThreadPool::getCurrentNode() % noShares;
+    nodeReplicas(context);
+    context.lastOccluder = new int[noLights];
+    for (i = 0; i < noLights; i++)
+        context.lastOccluder[i] = -1;
+    context.occluderHits = 0;
+    context.occluderMisses = 0;
+    context.samples = 0;
+    context.earlyStops = 0;
+    context.budgetStops = 0;
+
+    /* The rays of a tile and what they have found. */
+    context.rays = new Ray[MAX_BATCH];
+    context.shadowRays = new Ray[MAX_BATCH];
+    context.hits = new int[MAX_BATCH];
+    context.oldDirs = new vector[MAX_BATCH];
+    context.normals = new vector[MAX_BATCH];
+    context.transparency = new double[MAX_BATCH*noLights];
+    context.refracted = new Ray[MAX_BATCH];
+    context.refracts = new bool[MAX_BATCH];
+
+    /* Each ray traced takes one from the heap and may add two. */
+    context.pending = new Ray[rayBudget + 2];
+    context.pendingDepth = new int[rayBudget + 2];
+    context.noPending = 0;
+
+    /* And the pixels of the tile. */
+    context.tileColour = new colour[(TILE_SIZE + 2) * (TILE_SIZE + 2)];
+    context.tileSamples = new int[(TILE_SIZE + 2) * (TILE_SIZE + 2)];
+    context.tileIds = new int[(TILE_SIZE + 2) * (TILE_SIZE + 2)];
+    context.refined = new int[TILE_SIZE * TILE_SIZE];
+    
+    printf("Thread %d here, on node %d.\n", context.id, context.node);
+
+    /* The image is traced in square tiles, so that the rays of each
+     * tile stay close together.
+     */
+    tile t;
+    PerfCounter tlbMisses;
+    while (nextTile(&context, t))
+    {
+        renderTile(&context, t.x, t.y, t.width, t.height);
+        pixels += t.width * t.height;
+        if (__sync_bool_compare_and_swap(&firstTileDone, 0, 1))
+            firstTileTime = PerfCounter::now() - renderStart;
+    }
+
+    printf("Thread %d ended!\n", context.id);
+
+    /* How often the last occluder blocked the next shadow ray. */
+    long long lookups = context.occluderHits + context.occluderMisses;
+    printf("Thread %d shadow cache: %lld hits, %lld misses (%.1f%% hit rate).\n",
+            context.id, context.occluderHits, context.occluderMisses,
+            lookups > 0 ? 100.0 * context.occluderHits / lookups : 0.0);
+    printf("Thread %d traced %lld samples (%.2f per pixel).\n", context.id, context.samples,
+            pixels > 0 ? (double) context.samples / pixels : 0.0);
+    printf("Thread %d stopped %lld rays before the maximum depth, and %lld out of budget.\n",
+            context.id, context.earlyStops, context.budgetStops);
+    if (tlbMisses.isCounting())
+    {
+        long long misses = tlbMisses.read();
+        printf("Thread %d missed the TLB %lld times (%.2f per sample).\n", context.id, misses,
+                context.samples > 0 ? (double) misses / context.samples : 0.0);
     }
 
-    printf("Thread %d ended!\n", (*(int* )type));
-}
\ No newline at end of file
+    /* The last thread to end tells how long it all took. */
+    if (__sync_sub_and_fetch(&noRunning, 1) == 0)
+    {
+        BVH *tree = topLevel != NULL ? topLevel->getStaticTree() : bvh;
+
+        printf("Image traced in %.3f s, the first tile in %.3f s, with the accelerator built in %.3f s.\n",
+                PerfCounter::now() - renderStart, firstTileTime, topLevel != NULL ? topLevel->getBuildTime() :
+                bvh != NULL ? bvh->getBuildTime() : 0.0);
+        if (tree != NULL && tree->getNoSubtrees() > 0)
+            printf("Accelerator: %d of %d lazy subtrees were built.\n",
+                    tree->getNoExpanded(), tree->getNoSubtrees());
+    }
+
+    delete [] context.lastOccluder;
+    delete [] context.rays;
+    delete [] context.shadowRays;
+    delete [] context.hits;
+    delete [] context.oldDirs;
+    delete [] context.normals;
+    delete [] context.transparency;
+    delete [] context.refracted;
+    delete [] context.refracts;
+    delete [] context.pending;
+    delete [] context.pendingDepth;
+    delete [] context.tileColour;
+    delete [] context.tileSamples;
+    delete [] context.tileIds;
+    delete [] context.refined;
+
+    return NULL;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines the needed classes and their headers. */
+#include "Socket.h"
+#include "Message.h"
+#include "RenderServer.h"
+#include "ImageWriter.h"
+
+/* A colour becomes a shade from 0 to 255, as the default output does. */
+static unsigned char shade(double c)
+{
+    if (c <= 0)
+        return 0;
+    if (c >= 1)
+        return 255;
+    return (unsigned char) (c * 255 + 0.5);
+}
+
+/* Sends a job to a render server, started with -serve, and writes the
+ * image it gets back to a TGA, PPM or PNG file. The scene is the number of
+ * one of the scenes built in, or a file written with -savescene. With
+ * -tiles, the pixels come tile by tile, as they are traced.
+ */
+int main(int argc, char **argv)
+{
+    int i, x, y, type;
+    int width = 800, height = 600, samples = 16;
+    bool ownCamera = false, tiles = false;
+    point camera = {0, 0, 0};
+
+    if (argc < 5)
+    {
+        printf("Usage: %s host port scene|file output.tga|output.ppm|output.png "
+                "[-res width height] [-spp samples] [-camera x y z] [-tiles]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 5; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-res") == 0 && i + 2 < argc)
+        {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-spp") == 0 && i + 1 < argc)
+            samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-camera") == 0 && i + 3 < argc)
+        {
+            ownCamera = true;
+            camera.x = atof(argv[++i]);
+            camera.y = atof(argv[++i]);
+            camera.z = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-tiles") == 0)
+            tiles = true;
+    }
+
+    /* The scene is a number, or the file that holds it. */
+    Message scene;
+    char *end;
+    int number = strtol(argv[3], &end, 10);
+    bool inFile = *end != '\0';
+
+    if (inFile && !scene.load(argv[3]))
+    {
+        printf("Could not read the scene in %s.\n", argv[3]);
+        return 1;
+    }
+
+    Message job;
+    job.putInt(inFile ? SCENE_INLINE : SCENE_NUMBER);
+    job.putInt(width);
+    job.putInt(height);
+    job.putInt(samples);
+    job.putInt(tiles ? REPLY_TILES : REPLY_IMAGE);
+    job.putInt(ownCamera);
+    job.putPoint(camera);
+    if (inFile)
+        job.putBytes(scene.getData(), scene.getSize());
+    else
+        job.putInt(number);
+
+    Socket server;
+    if (!server.connect(argv[1], atoi(argv[2])) || !job.send(&server, MESSAGE_RENDER))
+    {
+        printf("Could not reach the server at %s:%s.\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    /* The image, one row after the other from the bottom. */
+    unsigned char *pixels = new unsigned char[width * height * 3];
+    memset(pixels, 0, width * height * 3);
+    int noTiles = 0;
+    Message reply;
+
+    while (reply.receive(&server, type) && type != MESSAGE_DONE)
+    {
+        if (type == MESSAGE_IMAGE)
+        {
+            if (reply.getInt() != width || reply.getInt() != height)
+                break;
+            reply.getBytes(pixels, width * height * 3);
+        }
+        else if (type == MESSAGE_PIXELS)
+        {
+            tile t;
+            t.x = reply.getInt();
+            t.y = reply.getInt();
+            t.width = reply.getInt();
+            t.height = reply.getInt();
+
+            if (t.x < 0 || t.y < 0 || t.width < 1 || t.width > TILE_SIZE || t.height < 1 || t.height > TILE_SIZE ||
+                    t.x + t.width > width || t.y + t.height > height)
+                break;
+
+            for (y = t.y; y < t.y + t.height; y++)
+                for (x = t.x; x < t.x + t.width; x++)
+                {
+                    colour c = reply.getColour();
+                    pixels[(y * width + x) * 3] = shade(c.r);
+                    pixels[(y * width + x) * 3 + 1] = shade(c.g);
+                    pixels[(y * width + x) * 3 + 2] = shade(c.b);
+                }
+
+            if (++noTiles % 100 == 0)
+                printf("%d tiles received.\n", noTiles);
+        }
+    }
+
+    if (type != MESSAGE_DONE)
+    {
+        printf("The server didn't finish the image.\n");
+        return 1;
+    }
+
+    printf("The scene was %s.\n", reply.getInt() ? "kept by the server" : "built");
+
+    ImageWriter writer(argv[4], width, height, NULL, false);
+    if (!writer.open())
+    {
+        printf("Could not write the image to %s.\n", argv[4]);
+        return 1;
+    }
+
+    writer.writeBand(pixels, 0, height);
+    writer.close();
+    printf("Image written to %s.\n", argv[4]);
+
+    delete [] pixels;
+    return 0;
+}
@@ -10,12 +10,21 @@
 #include "PlaneChess.h"
 #include "BasicStructures.h"
 #include "Object.h"
+#include "Message.h"
+#include "Arena.h"
+#include "BVH.h"
+#include "TopLevelBVH.h"
 
 extern int noObjects, noLights;
 extern Object **objects;
 extern Light *lights;
+extern Arena *sceneArena;
+extern BVH *bvh;
+extern TopLevelBVH *topLevel;
 extern long long fadingCoeficient;
 extern long long fullLightLimit;
+extern point camera;
+extern int visualizationType;
 
 /* SCENE DESCRIPTION:
  *    -> There is one ground plane and another at the right, working as a mirror.
@@ -28,19 +37,23 @@ void sceneOne()
     noObjects = 4;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Sphere *sphere = new Sphere(500.0,300, 4300.0, 80.0, 0.0, 0.0, 0.0);
+    Sphere *sphere = new (*sceneArena) Sphere(500.0,300, 4300.0, 80.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.9);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
     (*sphere).setRefraction(0.0);
+    /* It faces the mirror of the wall, so the rays bounce between them more
+     * times than the render would let them.
+     */
+    (*sphere).setMaxDepth(6);
 
     objects[0] = sphere;
     
-    sphere = new Sphere(400.0,300.0, 100.0, 50.0, 0.0, 0.0, 0.0);
+    sphere = new (*sceneArena) Sphere(400.0,300.0, 100.0, 50.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(80);
     (*sphere).setSpecular(1, 1, 1);
@@ -52,7 +65,7 @@ void sceneOne()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    Plane *plane = new Plane(0,0,0, normalZero, 0.0,0.0,0.7);
+    Plane *plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.0,0.0,0.7);
     (*plane).setReflection(0.0);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.4, 0.2);
@@ -62,11 +75,12 @@ void sceneOne()
 
     /* Right wall. */
     vector normalOne = {-1, 0, 0};
-    plane = new Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
+    plane = new (*sceneArena) Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
     (*plane).setReflection(0.9);
     (*plane).setShininess(50);
     (*plane).setSpecular(1, 1, 1);
     (*plane).setRefraction(0);
+    (*plane).setMaxDepth(6);
 
     objects[3] = plane;
 
@@ -84,11 +98,11 @@ void sceneTwo()
     noObjects = 3;
     noLights = 1;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Sphere *sphere = new Sphere(800.0,600, 5600.0, 380.0, 1.0, 0.0, 0.0);
+    Sphere *sphere = new (*sceneArena) Sphere(800.0,600, 5600.0, 380.0, 1.0, 0.0, 0.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -96,7 +110,7 @@ void sceneTwo()
 
     objects[0] = sphere;
 
-    sphere = new Sphere(380.0,220.0, 500.0, 250.0, 0.0, 0.0, 1.0);
+    sphere = new (*sceneArena) Sphere(380.0,220.0, 500.0, 250.0, 0.0, 0.0, 1.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -108,7 +122,7 @@ void sceneTwo()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    Plane *plane = new Plane(0,0,0, normalZero, 0.0,0.0,0.7);
+    Plane *plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.0,0.0,0.7);
     (*plane).setReflection(0.0);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.4, 0.2);
@@ -129,11 +143,11 @@ void sceneThree()
     noObjects = 4;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Sphere *sphere = new Sphere(500.0,500, 800.0, 280.0, 0.0, 0.0, 0.0);
+    Sphere *sphere = new (*sceneArena) Sphere(500.0,500, 800.0, 280.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.9);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -141,13 +155,13 @@ void sceneThree()
 
     objects[0] = sphere;
 
-    sphere = new Sphere(50.0,520.0, 600.0, 200.0, 0.0, 0.0, 1.0);
+    sphere = new (*sceneArena) Sphere(50.0,520.0, 600.0, 200.0, 0.0, 0.0, 1.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
     (*sphere).setRefraction(0.0);
 
-    /*sphere = new Sphere(450.0,300.0, 100.0, 50.0, 0.1, 0.1, 0.1);
+    /*sphere = new (*sceneArena) Sphere(450.0,300.0, 100.0, 50.0, 0.1, 0.1, 0.1);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(10);
     (*sphere).setSpecular(0.2, 0.2, 0.2);
@@ -160,7 +174,7 @@ void sceneThree()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    Plane *plane = new Plane(0,0,0, normalZero, 0.0,0.0,0.7);
+    Plane *plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.0,0.0,0.7);
     (*plane).setReflection(0.0);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.4, 0.2);
@@ -170,7 +184,7 @@ void sceneThree()
 
     /* Right wall. */
     vector normalOne = {-1, 0, 0};
-    plane = new Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
+    plane = new (*sceneArena) Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
     (*plane).setReflection(0.9);
     (*plane).setShininess(50);
     (*plane).setSpecular(1, 1, 1);
@@ -195,11 +209,11 @@ void sceneFour()
     noObjects = 4;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Sphere *sphere = new Sphere(550.0,400, 500.0, 180.0, 0.0, 0.0, 0.0);
+    Sphere *sphere = new (*sceneArena) Sphere(550.0,400, 500.0, 180.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -207,7 +221,7 @@ void sceneFour()
 
     objects[0] = sphere;
 
-    sphere = new Sphere(300.0,380.0, 1000.0, 150.0, 0.0, 0.0, 1.0);
+    sphere = new (*sceneArena) Sphere(300.0,380.0, 1000.0, 150.0, 0.0, 0.0, 1.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -219,7 +233,7 @@ void sceneFour()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    Plane *plane = new Plane(0,0,0, normalZero, 0.0,0.0,0.3);
+    Plane *plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.0,0.0,0.3);
     (*plane).setReflection(0.5);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.6, 0.6);
@@ -229,7 +243,7 @@ void sceneFour()
 
     /* Back wall.*/
     vector normalTwo = {0, 0, -1};
-    plane = new Plane(0,0,100000, normalTwo, 0.1,0.1,0.8);
+    plane = new (*sceneArena) Plane(0,0,100000, normalTwo, 0.1,0.1,0.8);
     (*plane).setReflection(0.5);
     (*plane).setShininess(0.1);
     (*plane).setSpecular(0.1, 0.1, 0.1);
@@ -251,11 +265,11 @@ void sceneFive()
     noObjects = 2;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Cube *cube = new Cube(200.0,300, 500.0, 200,200,200, 1.0, 0.0, 0.0);
+    Cube *cube = new (*sceneArena) Cube(200.0,300, 500.0, 200,200,200, 1.0, 0.0, 0.0);
     (*cube).setReflection(0.0);
     (*cube).setShininess(50);
     (*cube).setSpecular(1, 1, 1);
@@ -265,7 +279,7 @@ void sceneFive()
 
     /* Back wall.*/
     vector normalOne = {1, 0, 0};
-    Plane *plane = new Plane(0,0,0, normalOne, 0.1,0.1,0.8);
+    Plane *plane = new (*sceneArena) Plane(0,0,0, normalOne, 0.1,0.1,0.8);
     (*plane).setReflection(0.0);
     (*plane).setShininess(50);
     (*plane).setSpecular(0.1, 0.1, 0.1);
@@ -286,7 +300,7 @@ void sceneFive()
 void addTree(int objectNo, double x, double z)
 {
      /* Cubes initialization. */
-    Cube *cube = new Cube(x, 25, z, 20, 50, 10, 0.55, 0.27, 0.07);
+    Cube *cube = new (*sceneArena) Cube(x, 25, z, 20, 50, 10, 0.55, 0.27, 0.07);
     (*cube).setReflection(0.0);
     (*cube).setShininess(10);
     (*cube).setSpecular(1, 1, 1);
@@ -295,7 +309,7 @@ void addTree(int objectNo, double x, double z)
     objects[objectNo] = cube;
 
         /* Spheres initialization. */
-    Sphere *sphere = new Sphere(x, 65 , z, 30.0, 0.13, 0.55, 0.13);
+    Sphere *sphere = new (*sceneArena) Sphere(x, 65 , z, 30.0, 0.13, 0.55, 0.13);
     (*sphere).setReflection(0.2);
     (*sphere).setShininess(40);
     (*sphere).setSpecular(0.2, 0.8, 0.2);
@@ -310,7 +324,7 @@ void addMountainBlock(int objectNo, int i, double x, double y, double z, double
         double e1, double e11, double e2, double e22, double e3, double e33)
 {
         /* Height definition */
-        Cube *cube = new Cube(x, y, z, xS, yS, zS,
+        Cube *cube = new (*sceneArena) Cube(x, y, z, xS, yS, zS,
         /* Colour definition */
         0.36 + (pow(NEPER, e1*i))*e11,
             0.25 + (pow(NEPER, e2*i))*e22,
@@ -328,7 +342,7 @@ void addMountainBlockTwo(int objectNo, int i, double x, double y, double z, doub
         double e1, double e11, double e2, double e22, double e3, double e33)
 {
         /* Height definition */
-        Cube *cube = new Cube(x, y, z, xS, yS, zS,
+        Cube *cube = new (*sceneArena) Cube(x, y, z, xS, yS, zS,
         /* Colour definition */
         0.36 + (pow(NEPER, e1*i))*e11,
             0.25 + (pow(NEPER, e2*i))*e22,
@@ -350,12 +364,12 @@ void sceneMountain()
     noObjects = 114;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Back wall: the sky..*/
     vector normalOne = {0, 0, -1};
-    Plane *plane = new Plane(0,0,10000, normalOne, 0.55,0.27,0.075);
+    Plane *plane = new (*sceneArena) Plane(0,0,10000, normalOne, 0.55,0.27,0.075);
     (*plane).setReflection(0.0);
     (*plane).setShininess(50);
     (*plane).setSpecular(0.1, 0.1, 0.1);
@@ -365,7 +379,7 @@ void sceneMountain()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    plane = new Plane(0,0,0, normalZero, 0.35,0.27,0.075);
+    plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.35,0.27,0.075);
     (*plane).setReflection(0.0);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.6, 0.6);
@@ -402,7 +416,7 @@ void sceneMountain()
     /* After adding all the mountains, we still add some blocks to join the
      * bottoms of each.
      */
-    cube = new Cube(900.0, 30, 400.0, 800, 60, 250, 0.36, 0.25, 0.2);
+    cube = new (*sceneArena) Cube(900.0, 30, 400.0, 800, 60, 250, 0.36, 0.25, 0.2);
     (*cube).setReflection(0.0);
     (*cube).setShininess(50);
     (*cube).setSpecular(1, 1, 1);
@@ -410,7 +424,7 @@ void sceneMountain()
     objects[89] = cube;
 
 
-    cube = new Cube(-750.0, 30, 800.0, 250, 60, 800, 0.36, 0.25, 0.2);
+    cube = new (*sceneArena) Cube(-750.0, 30, 800.0, 250, 60, 800, 0.36, 0.25, 0.2);
     (*cube).setReflection(0.0);
     (*cube).setShininess(50);
     (*cube).setSpecular(1, 1, 1);
@@ -418,7 +432,7 @@ void sceneMountain()
     objects[90] = cube;
 
     /* And now the water in the middle of the mountains. */
-    cube = new Cube(200.0, 20, 1000.0, 1800, 40, 850, 0.5, 0.3, 0.8);
+    cube = new (*sceneArena) Cube(200.0, 20, 1000.0, 1800, 40, 850, 0.5, 0.3, 0.8);
     (*cube).setReflection(1.0);
     (*cube).setShininess(10);
     (*cube).setSpecular(0, 0, 0);
@@ -452,12 +466,12 @@ void sceneTemp()
     noObjects = 136;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Back wall: the sky..*/
     vector normalOne = {0, 0, -1};
-    Plane *plane = new Plane(0,0,10000, normalOne, 0.55,0.27,0.075);
+    Plane *plane = new (*sceneArena) Plane(0,0,10000, normalOne, 0.55,0.27,0.075);
     (*plane).setReflection(0.0);
     (*plane).setShininess(50);
     (*plane).setSpecular(0.1, 0.1, 0.1);
@@ -467,7 +481,7 @@ void sceneTemp()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    plane = new Plane(0,0,0, normalZero, 0.35,0.27,0.075);
+    plane = new (*sceneArena) Plane(0,0,0, normalZero, 0.35,0.27,0.075);
     (*plane).setReflection(0.0);
     (*plane).setShininess(20);
     (*plane).setSpecular(0.6, 0.6, 0.6);
@@ -531,11 +545,11 @@ void sceneChess()
     noObjects = 5;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Spheres initialization. */
-    Sphere *sphere = new Sphere(500.0,300, 4300.0, 80.0, 0.0, 0.0, 0.0);
+    Sphere *sphere = new (*sceneArena) Sphere(500.0,300, 4300.0, 80.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(50);
     (*sphere).setSpecular(1, 1, 1);
@@ -543,7 +557,7 @@ void sceneChess()
 
     objects[0] = sphere;
 
-    sphere = new Sphere(400.0,300.0, 100.0, 50.0, 0.0, 0.0, 0.0);
+    sphere = new (*sceneArena) Sphere(400.0,300.0, 100.0, 50.0, 0.0, 0.0, 0.0);
     (*sphere).setReflection(0.0);
     (*sphere).setShininess(80);
     (*sphere).setSpecular(1, 1, 1);
@@ -555,7 +569,7 @@ void sceneChess()
 
     /* Ground. */
     vector normalZero = {0, 1, 0};
-    PlaneChess *planeChess = new PlaneChess(0,0,0, normalZero, 250.0);
+    PlaneChess *planeChess = new (*sceneArena) PlaneChess(0,0,0, normalZero, 250.0);
     (*planeChess).setReflection(0.0);
     (*planeChess).setShininess(0);
     (*planeChess).setSpecular(0, 0, 0);
@@ -565,7 +579,7 @@ void sceneChess()
 
     /* Right wall. */
     vector normalOne = {-1, 0, 0};
-    Plane *plane = new Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
+    Plane *plane = new (*sceneArena) Plane(1600,0,0, normalOne, 0.0,0.0,0.0);
     (*plane).setReflection(0.9);
     (*plane).setShininess(50);
     (*plane).setSpecular(1, 1, 1);
@@ -575,7 +589,7 @@ void sceneChess()
 
     /* Left wall. */
     vector normalTwo = {1, 0, 0};
-    plane = new Plane(0,0,0, normalTwo, 0.0,0.0,0.0);
+    plane = new (*sceneArena) Plane(0,0,0, normalTwo, 0.0,0.0,0.0);
     (*plane).setReflection(0.9);
     (*plane).setShininess(50);
     (*plane).setSpecular(1, 1, 1);
@@ -598,11 +612,11 @@ void sceneTriangles()
     noObjects = 3;
     noLights = 2;
 
-    objects = new Object *[noObjects];
-    lights = new Light[noLights];
+    objects = new (*sceneArena) Object *[noObjects];
+    lights = new (*sceneArena) Light[noLights];
 
     /* Triangles initialization. */
-    Triangle *triangle = new Triangle(1.0, 0.0, 0.0);
+    Triangle *triangle = new (*sceneArena) Triangle(1.0, 0.0, 0.0);
     (*triangle).setVertix(2, 700, 400, 1000);
     (*triangle).setVertix(1, 900, 400, 200);
     (*triangle).setVertix(0, 800, 700, 1700);
@@ -614,7 +628,7 @@ void sceneTriangles()
 
     objects[0] = triangle;
 
-    triangle = new Triangle(0.0, 1.0, 0.0);
+    triangle = new (*sceneArena) Triangle(0.0, 1.0, 0.0);
     (*triangle).setVertix(2, 800, 700, 1700);
     (*triangle).setVertix(1, 900, 400, 200);
     (*triangle).setVertix(0, 1200, 700, 500);
@@ -626,7 +640,7 @@ void sceneTriangles()
 
     objects[1] = triangle;
 
-    triangle = new Triangle(0.0, 0.0, 1.0);
+    triangle = new (*sceneArena) Triangle(0.0, 0.0, 1.0);
     (*triangle).setVertix(2, 900, 400, 200);
     (*triangle).setVertix(1, 1600, 500, 1000);
     (*triangle).setVertix(0, 1200, 700, 500);
@@ -647,6 +661,9 @@ void sceneTriangles()
 /* No works at the scene selection. */
 void buildScene(int no)
 {
+    /* The scene is made in an arena of its own, freed with freeScene(). */
+    sceneArena = new Arena();
+
     /* Selects the right scenario to be built. */
     switch(no)
     {
@@ -663,4 +680,174 @@ void buildScene(int no)
     }
 
     return;
-}
\ No newline at end of file
+}
+
+/* The objects that move in an animated scene: its spheres. Gives how many
+ * they are.
+ */
+int animatedObjects(int *animated)
+{
+    int i, noAnimated = 0;
+
+    for (i = 0; i < noObjects; i++)
+        if (objects[i]->getType() == OBJECT_SPHERE)
+            animated[noAnimated++] = i;
+
+    return noAnimated;
+}
+
+/* Moves the spheres of the scene from the last frame to this one. Each goes
+ * around a circle of its own, flat on the ground, from a different place
+ * along it. Gives the objects moved, and how many they are.
+ */
+int animateScene(int frame, int *moved)
+{
+    int k, noMoved = animatedObjects(moved);
+
+    for (k = 0; k < noMoved; k++)
+    {
+        int i = moved[k];
+        double before = 2 * M_PI * (frame - 1 + i) / ANIMATION_FRAMES;
+        double now = 2 * M_PI * (frame + i) / ANIMATION_FRAMES;
+        vector offset;
+        offset.x = ANIMATION_RADIUS * (cos(now) - cos(before));
+        offset.y = 0;
+        offset.z = ANIMATION_RADIUS * (sin(now) - sin(before));
+
+        objects[i]->move(offset);
+    }
+
+    return noMoved;
+}
+
+/* Writes the whole scene into a message: the camera, then each object
+ * after its kind, and the lights.
+ */
+void packScene(Message &m)
+{
+    int i;
+
+    m.putPoint(camera);
+    m.putInt(visualizationType);
+    m.putLong(fadingCoeficient);
+    m.putLong(fullLightLimit);
+
+    m.putInt(noObjects);
+    for (i = 0; i < noObjects; i++)
+    {
+        m.putInt(objects[i]->getType());
+        objects[i]->pack(m);
+    }
+
+    m.putInt(noLights);
+    for (i = 0; i < noLights; i++)
+        lights[i].pack(m);
+}
+
+/* An empty object of the type written by pack(), made in the arena, or
+ * NULL.
+ */
+static Object *newObject(int type, Arena &arena)
+{
+    switch (type)
+    {
+        case OBJECT_SPHERE: return new (arena) Sphere();
+        case OBJECT_PLANE: return new (arena) Plane();
+        case OBJECT_PLANE_CHESS: return new (arena) PlaneChess();
+        case OBJECT_CUBE: return new (arena) Cube();
+        case OBJECT_TRIANGLE: return new (arena) Triangle();
+        default: return NULL;
+    }
+}
+
+/* A copy of the objects of the scene, made in the arena. Its memory is
+ * taken by the calling thread, so it is close to the processor it runs on.
+ */
+Object **copyObjects(Arena &arena)
+{
+    Message m;
+    int i;
+
+    for (i = 0; i < noObjects; i++)
+    {
+        m.putInt(objects[i]->getType());
+        objects[i]->pack(m);
+    }
+
+    Object **copy = new (arena) Object *[noObjects];
+    for (i = 0; i < noObjects; i++)
+    {
+        copy[i] = newObject(m.getInt(), arena);
+        copy[i]->unpack(m);
+    }
+
+    return copy;
+}
+
+/* Builds the scene written by packScene(). Returns false if the message
+ * doesn't hold one.
+ */
+bool unpackScene(Message &m)
+{
+    int i;
+
+    /* The trees of the scene traced before stay with it, in the cache of
+     * a server, so freeScene() only frees what is built here.
+     */
+    sceneArena = new Arena();
+    lights = NULL;
+    bvh = NULL;
+    topLevel = NULL;
+
+    camera = m.getPoint();
+    visualizationType = m.getInt();
+    fadingCoeficient = m.getLong();
+    fullLightLimit = m.getLong();
+
+    noObjects = m.getInt();
+    if (!m.isValid() || noObjects < 0 || noObjects > m.getSize())
+        return false;
+
+    objects = new (*sceneArena) Object *[noObjects];
+    for (i = 0; i < noObjects; i++)
+    {
+        objects[i] = newObject(m.getInt(), *sceneArena);
+        if (objects[i] == NULL)
+        {
+            noObjects = i;
+            return false;
+        }
+
+        objects[i]->unpack(m);
+    }
+
+    noLights = m.getInt();
+    if (!m.isValid() || noLights < 0 || noLights > m.getSize())
+        return false;
+
+    lights = new (*sceneArena) Light[noLights];
+    for (i = 0; i < noLights; i++)
+        lights[i].unpack(m);
+
+    return m.isValid();
+}
+
+/* Frees the scene being traced, all at once, and its trees. */
+void freeScene()
+{
+    int i;
+
+    for (i = 0; lights != NULL && i < noLights; i++)
+        lights[i].freeOccluders();
+
+    delete bvh;
+    delete topLevel;
+    delete sceneArena;
+    bvh = NULL;
+    topLevel = NULL;
+    sceneArena = NULL;
+    objects = NULL;
+    lights = NULL;
+    noObjects = 0;
+    noLights = 0;
+}
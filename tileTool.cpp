@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Defines the needed classes and their headers. */
+#include "TiledImage.h"
+#include "ImageWriter.h"
+
+/* The rows of the image kept in memory at once. */
+#define BAND_ROWS 64
+
+/* A tile of one of the inputs. */
+struct inputTile
+{
+    int input, index;
+};
+
+/* Converts one or more tiled files, as written by the ray tracer with
+ * -tiled, into a TGA, PPM or PNG file. The files may each hold a part of
+ * the same image, traced with -crop or -tiles, and are put together. Only
+ * a band of rows is ever in memory, so the image may be far larger than it.
+ */
+int main(int argc, char **argv)
+{
+    int i, k, b, n;
+
+    if (argc < 3)
+    {
+        printf("Usage: %s input.tiles [input.tiles ...] output.tga|output.ppm|output.png\n", argv[0]);
+        return 1;
+    }
+
+    int noInputs = argc - 2;
+    char *outputFile = argv[argc - 1];
+    TiledImage **inputs = new TiledImage*[noInputs];
+
+    for (n = 0; n < noInputs; n++)
+    {
+        inputs[n] = new TiledImage(argv[n + 1]);
+        if (!inputs[n]->load())
+        {
+            printf("%s is not a tiled image.\n", argv[n + 1]);
+            return 1;
+        }
+
+        if (inputs[n]->getWidth() != inputs[0]->getWidth() || inputs[n]->getHeight() != inputs[0]->getHeight())
+        {
+            printf("%s is not of the same image as %s.\n", argv[n + 1], argv[1]);
+            return 1;
+        }
+    }
+
+    int width = inputs[0]->getWidth();
+    int height = inputs[0]->getHeight();
+    int noBands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    long long covered = 0;
+
+    /* Finds the tiles that fall on each band. A tile may fall on two. */
+    int *first = new int[noBands + 1];
+    memset(first, 0, (noBands + 1) * sizeof(int));
+
+    for (n = 0; n < noInputs; n++)
+        for (i = 0; i < inputs[n]->getNoTiles(); i++)
+        {
+            tile t = inputs[n]->getTile(i);
+            covered += (long long) t.width * t.height;
+            if (t.height == 0)
+                continue;
+            for (b = t.y / BAND_ROWS; b <= (t.y + t.height - 1) / BAND_ROWS; b++)
+                first[b + 1]++;
+        }
+
+    for (b = 0; b < noBands; b++)
+        first[b + 1] += first[b];
+
+    inputTile *inBand = new inputTile[first[noBands]];
+    int *filled = new int[noBands];
+    memset(filled, 0, noBands * sizeof(int));
+
+    for (n = 0; n < noInputs; n++)
+        for (i = 0; i < inputs[n]->getNoTiles(); i++)
+        {
+            tile t = inputs[n]->getTile(i);
+            if (t.height == 0)
+                continue;
+            for (b = t.y / BAND_ROWS; b <= (t.y + t.height - 1) / BAND_ROWS; b++)
+            {
+                inputTile it = {n, i};
+                inBand[first[b] + filled[b]++] = it;
+            }
+        }
+
+    /* The parts may overlap, or miss some pixels, but they should not. */
+    if (covered != (long long) width * height)
+        printf("The tiles cover %lld pixels of the %lld of the image.\n", covered, (long long) width * height);
+
+    ImageWriter output(outputFile, width, height, NULL, false);
+    if (!output.open())
+    {
+        printf("Could not write the image to %s.\n", outputFile);
+        return 1;
+    }
+
+    /* The bands go in the order of the file. Pixels no tile covers stay
+     * black.
+     */
+    unsigned char *band = new unsigned char[(long long) width * BAND_ROWS * 3];
+
+    for (k = 0; k < noBands; k++)
+    {
+        b = output.isBottomUp() ? k : noBands - 1 - k;
+
+        int y = b * BAND_ROWS;
+        int rows = height - y < BAND_ROWS ? height - y : BAND_ROWS;
+
+        memset(band, 0, (long long) width * rows * 3);
+
+        for (i = first[b]; i < first[b + 1]; i++)
+        {
+            TiledImage *input = inputs[inBand[i].input];
+            tile t = input->getTile(inBand[i].index);
+            int from = t.y > y ? t.y : y;
+            int to = t.y + t.height < y + rows ? t.y + t.height : y + rows;
+
+            if (!input->readRows(inBand[i].index, from - t.y, to - from,
+                        &band[((long long) (from - y) * width + t.x) * 3], width * 3))
+            {
+                printf("%s is cut short.\n", argv[inBand[i].input + 1]);
+                return 1;
+            }
+        }
+
+        output.writeBand(band, y, rows);
+    }
+
+    output.close();
+    printf("Image written to %s.\n", outputFile);
+
+    for (n = 0; n < noInputs; n++)
+        delete inputs[n];
+    delete [] inputs;
+    delete [] band;
+    delete [] first;
+    delete [] inBand;
+    delete [] filled;
+
+    return 0;
+}